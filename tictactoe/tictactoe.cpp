@@ -1,8 +1,38 @@
 ///////////////////////////////////////////////////////////////////////////////////
 // TODO:: #include any needed files
 ///////////////////////////////////////////////////////////////////////////////////
+// The results sink writes its files with fopen/fwrite
+#if defined _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
 #include <random>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+
+// Thread pinning reads the CPU topology from sysfs and is only available on Linux
+#if defined __linux__
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+// Value table snapshots replace the previous snapshot with MoveFileEx on Windows
+#if defined _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
 
 using namespace std;
 // Include file and line numbers for memory leak detection for visual studio in debug mode
@@ -61,6 +91,58 @@ enum class PlayerType
 	O
 };
 
+///////////////////////////////////////////////////////////////////////////////////
+// The strategies a player can use to pick its moves
+///////////////////////////////////////////////////////////////////////////////////
+enum class PlayerStrategy
+{
+	// Picks a random empty spot
+	Random,
+	// Runs a multithreaded Monte Carlo Tree Search for every move. See MctsChooseMove.
+	MonteCarloTreeSearch,
+	// Plays from and trains the value table shared by all learning players. See LearnFromGame.
+	Learning,
+	// Plays the best move according to a frozen value table loaded from a snapshot
+	Greedy
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// The formats the results sink can write game results in
+///////////////////////////////////////////////////////////////////////////////////
+enum class ResultsFormat
+{
+	// One line of text per game, followed by the summary
+	Text,
+	// Only the summary totals
+	Summary,
+	// One comma separated row per game
+	Csv,
+	// Blocks of column arrays. See FormatResultsChunk for the layout.
+	Binary
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Expansion state of an MCTS node. Only the thread that moves a node from Leaf to
+//   Expanding is allowed to create its children.
+///////////////////////////////////////////////////////////////////////////////////
+enum class MctsExpansionState
+{
+	Leaf,
+	Expanding,
+	Expanded
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// State of an entry in the analytic memo table. Only the thread that moves an entry
+//   from Empty to Computing writes its outcome.
+///////////////////////////////////////////////////////////////////////////////////
+enum class AnalyticMemoState
+{
+	Empty,
+	Computing,
+	Ready
+};
+
 ///////////////////////////////////////////////////////////////////////////////////
 // Various types of operations that can be performed on our synchronization object
 //   via LogSync.
@@ -107,6 +189,174 @@ struct Game
 	// A 3x3 array of PlayerTypes that represents the game board. Each entry will represent
 	//  which player currently owns that spot or 'None' if the spot is not taken.
 	PlayerType gameBoard[3][3];
+	// Time at which the last player to move notified the other player. Used to measure
+	//  how long it takes to hand the turn over to the other player's thread.
+	std::chrono::steady_clock::time_point handoffStartTime;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Search settings shared by every MCTS player
+///////////////////////////////////////////////////////////////////////////////////
+struct MctsSettings
+{
+	// Number of threads that search one shared tree for every move
+	int threadCount;
+	// Number of playouts per move or 0 for no playout limit
+	int iterationBudget;
+	// Number of milliseconds per move or 0 for no time limit
+	int timeBudgetMs;
+	// Maximum number of nodes a single search may allocate from its arena
+	int arenaNodeCapacity;
+	// UCT exploration constant
+	double explorationConstant;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// A single node of an MCTS search tree. Every field that is touched by more than
+//   one search thread is atomic so the tree can be shared without locks.
+///////////////////////////////////////////////////////////////////////////////////
+struct MctsNode
+{
+	// Parent of this node or nullptr for the root
+	MctsNode* parent;
+	// First entry of this node's contiguous block of children. It is published with
+	//  release semantics only after every child has been initialized.
+	std::atomic<MctsNode*> children;
+	// Number of entries in children. Written before children is published.
+	int childCount;
+	// Board spot (row * 3 + col) that was played to reach this node or -1 for the root
+	int move;
+	// Player that played 'move'
+	PlayerType mover;
+	// See MctsExpansionState for more details
+	std::atomic<MctsExpansionState> expansionState;
+	// Number of playouts that have been backed up through this node
+	std::atomic<int> visitCount;
+	// Number of playouts currently in flight through this node. Each one counts as a
+	//  loss until it's backed up so other threads are steered to different branches.
+	std::atomic<int> virtualLoss;
+	// Sum of playout results from the point of view of 'mover' in half points
+	//  (win = 2, draw = 1, loss = 0)
+	std::atomic<int> rewardSum;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Bump allocator that hands out MctsNodes to all search threads of a player. The
+//   node storage is allocated once and every search releases all of its nodes in
+//   one shot with MctsArenaReset.
+///////////////////////////////////////////////////////////////////////////////////
+struct MctsArena
+{
+	// Storage for all nodes or nullptr until the first search runs
+	MctsNode* nodes;
+	// Number of entries in nodes
+	int capacity;
+	// Number of entries handed out since the last reset
+	std::atomic<int> used;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Contains all data shared by the threads running a single MCTS search
+///////////////////////////////////////////////////////////////////////////////////
+struct MctsSearch
+{
+	// The board the search was started from
+	PlayerType rootBoard[3][3];
+	// Player whose turn it is on rootBoard
+	PlayerType rootTurn;
+	// Root of the shared search tree
+	MctsNode* root;
+	// Arena every node of this search is allocated from
+	MctsArena* arena;
+	// Settings for this search
+	const MctsSettings* settings;
+	// Number of playouts claimed by all threads. Used to enforce the iteration budget.
+	std::atomic<int> playoutsClaimed;
+	// Number of playouts completed by all threads
+	std::atomic<long long> playoutsCompleted;
+	// Time all threads spent in their playout loops, in nanoseconds
+	std::atomic<long long> threadNanoseconds;
+	// Every thread stops searching at this time when a time budget is used
+	std::chrono::steady_clock::time_point deadline;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Helper threads owned by an MCTS player. They're created with the player's first
+//   search and stay parked on workCondition between searches.
+///////////////////////////////////////////////////////////////////////////////////
+struct MctsHelperPool
+{
+	// The helper threads
+	std::thread* threads;
+	// Number of entries in threads
+	int threadCount;
+	// Search the helpers are working on or nullptr between searches
+	MctsSearch* search;
+	// Incremented every time a new search is handed to the helpers
+	long long searchGeneration;
+	// Number of helpers that haven't finished the current search yet
+	int activeCount;
+	// Set when the helpers should exit
+	bool shutdown;
+	// CPUs the helpers may run on or nullptr if they aren't pinned
+	const int* cpus;
+	// Number of entries in cpus
+	int cpuCount;
+	// Mutex to access all of the above in a thread safe manner
+	std::mutex poolMutex;
+	// Notified when a new search is started or the helpers should exit
+	std::condition_variable workCondition;
+	// Notified when the last helper finishes the current search
+	std::condition_variable doneCondition;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Settings shared by every learning player
+///////////////////////////////////////////////////////////////////////////////////
+struct LearningSettings
+{
+	// How far each value is moved towards its target after every game
+	float learningRate;
+	// Probability of picking a random move instead of the best one
+	float explorationRate;
+	// Number of learning episodes between snapshots or 0 for no periodic snapshots
+	long long snapshotInterval;
+	// File snapshots are written to or nullptr for no snapshots
+	const char* snapshotPath;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Value of every board, indexed by canonical packed board (see CanonicalizeBoard),
+//   from X's point of view: 1 = X wins, 0.5 = draw, 0 = O wins. Learning players
+//   update it concurrently with relaxed atomics and no locks.
+///////////////////////////////////////////////////////////////////////////////////
+struct ValueTable
+{
+	// One value per packed board
+	std::atomic<float>* values;
+	// Number of entries in values
+	int entryCount;
+	// Number of games learned from. A game played by two learning players counts twice.
+	std::atomic<long long> episodes;
+	// Number of snapshots written to disk
+	std::atomic<int> snapshotsWritten;
+	// Makes sure only one snapshot is written at a time
+	std::mutex snapshotMutex;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// The result of a single completed game
+///////////////////////////////////////////////////////////////////////////////////
+struct GameRecord
+{
+	// ID of the game
+	int gameNumber;
+	// Thread ID of the X player
+	int playerX;
+	// Thread ID of the O player
+	int playerO;
+	// Player that won or 'None' if the game was a draw
+	PlayerType winner;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -117,13 +367,13 @@ struct Player
 	// ID of the player
 	int id;
 	// Number of games this player has played
-	int gamesPlayed;
+	long long gamesPlayed;
 	// Number of games this player won
-	int winCount;
+	long long winCount;
 	// Number of games this player lost
-	int loseCount;
+	long long loseCount;
 	// Number of games this player tied
-	int drawCount;
+	long long drawCount;
 	// Type of player this player represents
 	PlayerType type;
 	// Pointer to the pool of games. See GamePool for more details.
@@ -132,6 +382,158 @@ struct Player
 	struct PlayerPool* playerPool;
 	// random number generator for this thread
 	UniformRandInt myRand;
+	// Strategy this player uses to pick its moves
+	PlayerStrategy strategy;
+	// Settings shared by all MCTS players. Only used when strategy is MonteCarloTreeSearch.
+	const MctsSettings* mctsSettings;
+	// Node arena reused by every search this player runs
+	MctsArena mctsArena;
+	// Helper threads that search alongside this player or nullptr until the first search
+	MctsHelperPool* mctsHelpers;
+	// Total number of playouts run by this player's searches
+	long long mctsPlayouts;
+	// Total wall clock time this player spent searching, in seconds
+	double mctsSearchSeconds;
+	// Total time all of this player's search threads spent running playouts, in seconds
+	double mctsThreadSeconds;
+	// Index of the first game in the pool this player tries to join
+	int firstGameIndex;
+	// One past the index of the last game in the pool this player tries to join
+	int endGameIndex;
+	// True if this player's thread constructs the games in [firstGameIndex, endGameIndex)
+	//  so their memory is first touched on the NUMA node the thread is pinned to.
+	bool initializesGames;
+	// CPU this player's thread is pinned to or -1 if it isn't pinned
+	int pinnedCpu;
+	// NUMA node of pinnedCpu or -1 if it isn't pinned
+	int pinnedNode;
+	// CPUs this player's MCTS helper threads may run on or nullptr if they aren't pinned
+	int* helperCpus;
+	// Number of entries in helperCpus
+	int helperCpuCount;
+	// Number of times this player was woken up to take over the turn
+	long long handoffCount;
+	// Total time between the other player's notify and this player waking up, in seconds
+	double handoffSeconds;
+	// Value table used by learning and greedy players. Learning players share one table,
+	//  greedy players share a frozen one loaded from a snapshot.
+	ValueTable* valueTable;
+	// Settings shared by all learning players. Only used when strategy is Learning.
+	const LearningSettings* learningSettings;
+	// Canonical packed boards this player moved to in the current game
+	int learningHistory[5];
+	// Number of entries in learningHistory
+	int learningHistoryCount;
+	// Full chunk of results this player took from the sink while holding a game's mutex.
+	//  It's written out by JoinGame once the game's mutex is released.
+	GameRecord* fullResultsChunk;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Topology of the CPUs this process may run on
+///////////////////////////////////////////////////////////////////////////////////
+struct CpuTopology
+{
+	// Number of entries in cpuOrder, cpuNode and cpuL3Domain
+	int cpuCount;
+	// CPU IDs sorted by NUMA node, then L3 cache domain, then physical core. Neighboring
+	//  entries are SMT siblings or share an L3 whenever the machine allows it.
+	int* cpuOrder;
+	// NUMA node of each entry in cpuOrder
+	int* cpuNode;
+	// L3 cache domain of each entry in cpuOrder, identified by its lowest CPU ID
+	int* cpuL3Domain;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Receives game results as soon as games complete. Records are collected into
+//   chunks; the player thread that fills a chunk formats it and writes it out with a
+//   single write once it has released the game's mutex, so several chunks can be
+//   formatted in parallel. The summary totals are kept as running aggregates.
+///////////////////////////////////////////////////////////////////////////////////
+struct ResultsSink
+{
+	// Format the results are written in
+	ResultsFormat format;
+	// Where the results are written. Either stdout or a file opened by OpenResultsSink.
+	FILE* output;
+	// Records that haven't been formatted yet. Only accessed with chunkMutex locked.
+	GameRecord* pendingRecords;
+	// Number of entries in pendingRecords
+	int pendingCount;
+	// Number of records formatted and written at once
+	int chunkCapacity;
+	// Mutex to access pendingRecords and pendingCount in a thread safe manner
+	std::mutex chunkMutex;
+	// Makes sure only one chunk is written to output at a time
+	std::mutex writeMutex;
+	// Set when a write to output failed, so the results written are incomplete.
+	//  Only accessed with writeMutex locked while player threads are running.
+	bool writeFailed;
+	// Number of games that have completed
+	std::atomic<long long> gamesCompleted;
+	// Number of games won by the X player
+	std::atomic<long long> xWins;
+	// Number of games won by the O player
+	std::atomic<long long> oWins;
+	// Number of games that were a draw
+	std::atomic<long long> draws;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// Probabilities of each way a game can end
+///////////////////////////////////////////////////////////////////////////////////
+struct OutcomeProbabilities
+{
+	// Probability that X wins
+	double xWin;
+	// Probability that O wins
+	double oWin;
+	// Probability of a draw
+	double draw;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// A single entry of the analytic memo table, indexed by packed board. See PackBoard.
+///////////////////////////////////////////////////////////////////////////////////
+struct AnalyticMemoEntry
+{
+	// See AnalyticMemoState for more details
+	std::atomic<AnalyticMemoState> state;
+	// Outcome probabilities from this board. Only valid once state is Ready.
+	OutcomeProbabilities outcome;
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+// A fixed number of reusable game slots that games are created in on demand when
+//   streaming. See TryToPlayStreamingGames for more details.
+///////////////////////////////////////////////////////////////////////////////////
+struct GameRing
+{
+	// The game slots
+	Game* slots;
+	// Number of entries in slots
+	int slotCount;
+	// True for every slot that still has a player in it. Only accessed with ringMutex locked.
+	bool* slotInUse;
+	// Slot to start looking for a free slot from. Only accessed with ringMutex locked.
+	int nextSlot;
+	// Slot with a single player waiting for an opponent or -1. Only accessed with ringMutex locked.
+	int openSlot;
+	// Number of games created so far. Only accessed with ringMutex locked.
+	long long gamesCreated;
+	// Number of games to create or 0 for no limit
+	long long maxGameCount;
+	// Milliseconds after startTime at which no more games are created or 0 for no limit
+	long long durationMs;
+	// Maximum number of games created per second or 0 for no limit
+	double gamesPerSecondTarget;
+	// Time the starting gun was fired
+	std::chrono::steady_clock::time_point startTime;
+	// Mutex to access the ring in a thread safe manner
+	std::mutex ringMutex;
+	// Notified whenever a slot is recycled
+	std::condition_variable slotFreeCondition;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -143,6 +545,10 @@ struct GamePool
 	Game* perGameData;
 	// Total number of games and the number of entries in perGameData
 	int totalGameCount;
+	// Sink that receives the result of every game. See ResultsSink for more details.
+	ResultsSink* resultsSink;
+	// Ring the games are created in when streaming or nullptr. The ring's slots are perGameData.
+	GameRing* gameRing;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -152,21 +558,65 @@ struct GamePool
 ///////////////////////////////////////////////////////////////////////////////////
 struct PlayerPool
 {
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: You will need to add variables here to keep track of the total number of
-	//   player threads in a thread-safe manner and implement the starting gun logic.
-	///////////////////////////////////////////////////////////////////////////////////
+	// Number of player threads that are ready or still playing
 	int count;
-
+	// Mutex to access count and startGameFlag in a thread safe manner
 	std::mutex countMutex;
-
+	// Notified when count changes or the starting gun is fired
 	std::condition_variable countCondition;
-
-	std::unique_lock<std::mutex>* playerUniqueLock;
-
+	// Set by main once every player is ready to start playing
 	bool startGameFlag;
 };
 
+///////////////////////////////////////////////////////////////////////////////////
+// Optional settings that can be passed on the command line after gameCount and
+//   playerCount. See ParseRunOptions for more details.
+///////////////////////////////////////////////////////////////////////////////////
+struct RunOptions
+{
+	// Number of players, starting with player 0, that use MCTS. All other players pick random moves.
+	int mctsPlayerCount;
+	// Search settings shared by all MCTS players
+	MctsSettings mcts;
+	// Pin each pair of player threads to neighboring CPUs and give each pair its own
+	//  range of games. See LoadCpuTopology for more details.
+	bool pinThreads;
+	// Format the game results are written in
+	ResultsFormat resultsFormat;
+	// File the game results are written to or nullptr for the standard output
+	const char* resultsPath;
+	// False if the per-move and per-game progress messages should not be printed
+	bool printProgress;
+	// Compute the exact outcome probabilities of random vs random play and compare them
+	//  with the rates observed in this run. See RunAnalyticMode for more details.
+	bool analytic;
+	// True if the analytic outcome of analyticBoard should be reported as well
+	bool analyticQuery;
+	// Position to compute the analytic outcome of
+	PlayerType analyticBoard[3][3];
+	// Player to move in analyticBoard
+	PlayerType analyticTurn;
+	// Number of players, following the MCTS players, that learn from self-play
+	int learningPlayerCount;
+	// Number of players, following the learning players, that play greedily from a snapshot
+	int greedyPlayerCount;
+	// Settings shared by all learning players
+	LearningSettings learning;
+	// Snapshot the greedy players play from and the learning players start from
+	const char* loadSnapshotPath;
+	// Create games on demand in a ring of recycled slots instead of preallocating all of them
+	bool streaming;
+	// Number of slots in the ring or 0 to pick one from the player count
+	int ringSize;
+	// Milliseconds to keep creating streaming games for or 0 for no limit
+	long long durationMs;
+	// Maximum number of streaming games created per second or 0 for no limit
+	double gamesPerSecondTarget;
+};
+
+// When false the per-move and per-game progress messages are not printed. See LogProgress.
+bool printProgress = true;
+
 ///////////////////////////////////////////////////////////////////////////////////
 // Prompts the user to press enter and waits for user input
 ///////////////////////////////////////////////////////////////////////////////////
@@ -245,6 +695,32 @@ int Log(const char* format, ...)
 	return result;
 }
 
+///////////////////////////////////////////////////////////////////////////////////
+// Prints a progress message exactly like printf unless progress messages have been
+//   turned off with --quiet.
+//
+// Arguments:
+//   format - Format of string to print.
+//   ... - Additional arguments. See documentation for printf().
+//
+// Returns:
+//   Result of vprintf or 0 if progress messages are turned off
+///////////////////////////////////////////////////////////////////////////////////
+int LogProgress(const char* format, ...)
+{
+	if (!printProgress)
+	{
+		return 0;
+	}
+
+	va_list args;
+	va_start(args, format);
+	int result = vprintf(format, args);
+	va_end(args);
+
+	return result;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 // Prints the current game board to the console
 //
@@ -281,18 +757,18 @@ void PrintGameBoard(const Game* currentGame)
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
-// Determines if the player made a winning move on the game board
+// Determines if 'type' made a winning move on 'board'
 //
 // Arguments:
-//   row - The row 'player' picked to play at
-//   col - The column 'player' picked to play at
-//   game - Pointer to the game being checked
-//   player - Pointer to the player that made the move
+//   row - The row that was played
+//   col - The column that was played
+//   board - The board to check
+//   type - The player that played at [row, col]
 //
 // Return:
-//   True if player won, otherwise false
+//   True if the move completed a row, column or diagonal, otherwise false
 ///////////////////////////////////////////////////////////////////////////////////
-bool DidWeWin(int row, int col, const Game* game, const Player* player)
+bool IsWinningMove(int row, int col, const PlayerType board[3][3], PlayerType type)
 {
 	bool completeRow = true;
 	bool completeCol = true;
@@ -303,13 +779,13 @@ bool DidWeWin(int row, int col, const Game* game, const Player* player)
 	//  a winning move.
 	for (int i = 0; i < 3; i++)
 	{
-		if (game->gameBoard[row][i] != player->type)
+		if (board[row][i] != type)
 			completeRow = false;
-		if (game->gameBoard[i][col] != player->type)
+		if (board[i][col] != type)
 			completeCol = false;
-		if (game->gameBoard[i][i] != player->type)
+		if (board[i][i] != type)
 			completeDiagonalA = false;
-		if (game->gameBoard[2 - i][i] != player->type)
+		if (board[2 - i][i] != type)
 			completeDiagonalB = false;
 	}
 
@@ -317,144 +793,1864 @@ bool DidWeWin(int row, int col, const Game* game, const Player* player)
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
-// Play the entire game of Tic-Tac-Toe as 'currentPlayer' in 'currentGame'
+// Determines if the player made a winning move on the game board
 //
 // Arguments:
-//   currentPlayer - Pointer to the player that is trying to play each game
-//   currentGame - Pointer to the game that is being joined
+//   row - The row 'player' picked to play at
+//   col - The column 'player' picked to play at
+//   game - Pointer to the game being checked
+//   player - Pointer to the player that made the move
 //
-// Note:
-//   6. Pick a spot on the board to play
-//   7. IF The game is over: wake up the other player so it can play and return.
-//   7. IF The game isn't over: wake up the other player and go to sleep. Next player starts at #6
+// Return:
+//   True if player won, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool DidWeWin(int row, int col, const Game* game, const Player* player)
+{
+	return IsWinningMove(row, col, game->gameBoard, player->type);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Releases every node handed out by 'arena' in one shot
 //
-//  gameUniqueLock is the primary synchronization object 
+// Arguments:
+//   arena - The arena to reset
 ///////////////////////////////////////////////////////////////////////////////////
-GameState MakeAMove(Player* currentPlayer, Game* currentGame)
+void MctsArenaReset(MctsArena* arena)
 {
-	int possibleMoves[9];
-	int totalPossibleMoves = 0;
+	arena->used.store(0, std::memory_order_relaxed);
+}
 
-	// Find all valid moves this player can make
-	for (int row = 0; row < 3; row++)
+///////////////////////////////////////////////////////////////////////////////////
+// Hands out a contiguous block of nodes from 'arena'. Safe to call from any number
+//   of search threads at the same time.
+//
+// Arguments:
+//   arena - The arena to allocate from
+//   count - Number of nodes to allocate
+//
+// Return:
+//   Pointer to the first node or nullptr if the arena is full
+///////////////////////////////////////////////////////////////////////////////////
+MctsNode* MctsArenaAllocate(MctsArena* arena, int count)
+{
+	// Once the arena is full stop bumping 'used' so long searches can't overflow it
+	if (arena->used.load(std::memory_order_relaxed) >= arena->capacity)
 	{
-		for (int col = 0; col < 3; col++)
-		{
-			if (currentGame->gameBoard[row][col] == PlayerType::None)
-			{
-				possibleMoves[totalPossibleMoves++] = (row * 3) + col;
-			}
-		}
+		return nullptr;
 	}
 
-	if (totalPossibleMoves != 0)
+	int first = arena->used.fetch_add(count, std::memory_order_relaxed);
+	if (first + count > arena->capacity)
 	{
-		// There are valid moves left on the board, pick a random valid location
-		int randomMoveIndex = currentPlayer->myRand() % totalPossibleMoves;
+		return nullptr;
+	}
 
-		int row = possibleMoves[randomMoveIndex] / 3;
-		int col = possibleMoves[randomMoveIndex] % 3;
-		currentGame->gameBoard[row][col] = currentPlayer->type;
+	return &arena->nodes[first];
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Initializes a node that was just handed out by the arena
+//
+// Arguments:
+//   node - The node to initialize
+//   parent - Parent of the node or nullptr for the root
+//   move - Board spot that was played to reach this node or -1 for the root
+//   mover - Player that played 'move'
+///////////////////////////////////////////////////////////////////////////////////
+void MctsInitNode(MctsNode* node, MctsNode* parent, int move, PlayerType mover)
+{
+	node->parent = parent;
+	node->children.store(nullptr, std::memory_order_relaxed);
+	node->childCount = 0;
+	node->move = move;
+	node->mover = mover;
+	node->expansionState.store(MctsExpansionState::Leaf, std::memory_order_relaxed);
+	node->visitCount.store(0, std::memory_order_relaxed);
+	node->virtualLoss.store(0, std::memory_order_relaxed);
+	node->rewardSum.store(0, std::memory_order_relaxed);
+}
 
-		printf("Game %d: Player %d: Picked [Row: %d, Col: %d]\n", currentGame->gameNumber, currentPlayer->id, row, col);
+///////////////////////////////////////////////////////////////////////////////////
+// Picks the child of 'node' with the best UCT score. Playouts that are still in
+//   flight count as losses (virtual loss) so concurrent threads spread out over
+//   the tree instead of all following the same path.
+//
+// Arguments:
+//   node - The expanded node to pick a child from
+//   children - The published children of 'node'
+//   explorationConstant - UCT exploration constant
+//
+// Return:
+//   The selected child
+///////////////////////////////////////////////////////////////////////////////////
+MctsNode* MctsSelectChild(const MctsNode* node, MctsNode* children, double explorationConstant)
+{
+	int parentVisits = node->visitCount.load(std::memory_order_relaxed) + node->virtualLoss.load(std::memory_order_relaxed) + 1;
+	double logParentVisits = log((double)parentVisits);
+	MctsNode* bestChild = &children[0];
+	double bestScore = -1.0;
 
-		if (DidWeWin(row, col, currentGame, currentPlayer))
-		{
-			printf("Game %d:Player %d - Won\n", currentGame->gameNumber, currentPlayer->id);
-			currentPlayer->winCount++;
+	for (int i = 0; i < node->childCount; i++)
+	{
+		MctsNode* child = &children[i];
+		int visits = child->visitCount.load(std::memory_order_relaxed) + child->virtualLoss.load(std::memory_order_relaxed);
 
-			return GameState::Won;
+		// Always try unvisited children first
+		if (visits == 0)
+		{
+			return child;
 		}
-		else
+
+		double winRate = child->rewardSum.load(std::memory_order_relaxed) / (2.0 * visits);
+		double score = winRate + explorationConstant * sqrt(logParentVisits / visits);
+		if (score > bestScore)
 		{
-			return GameState::StillPlaying;
+			bestScore = score;
+			bestChild = child;
 		}
 	}
 
-	// There are no more moves left, game resulted in a draw.
-	printf("Game %d:Player %d - Draw\n", currentGame->gameNumber, currentPlayer->id);
-	currentPlayer->drawCount++;
-
-	return GameState::Draw;
+	return bestChild;
 }
 
-bool yourTurn = false;
-bool myTurn = false;
-
 ///////////////////////////////////////////////////////////////////////////////////
-// Play the entire game of Tic-Tac-Toe as 'currentPlayer' in 'currentGame'
+// Runs a single MCTS iteration (selection, expansion, random playout and backup)
+//   on the shared tree.
 //
 // Arguments:
-//   currentPlayer - Pointer to the player that is trying to play each game
-//   currentGame - Pointer to the game that is being joined
-//
-// Note:
-//   6. Pick a spot on the board to play
-//   7. IF The game is over: wake up the other player so it can play and return.
-//   7. IF The game isn't over: wake up the other player and go to sleep. Next player starts at #6
-//
-//  gameUniqueLock is the primary synchronization object 
+//   search - The search being run
+//   randEngine - Random number generator owned by the calling thread
 ///////////////////////////////////////////////////////////////////////////////////
-void PlayGame(Player* currentPlayer, Game* currentGame)
+void MctsRunPlayout(MctsSearch* search, std::mt19937* randEngine)
 {
-	printf("Game %d:Player %d vs Player %d (Player %d) starting\n", currentGame->gameNumber, currentGame->playerX, currentGame->playerO, currentPlayer->id);
+	PlayerType board[3][3];
+	memcpy(board, search->rootBoard, sizeof(board));
+	PlayerType turn = search->rootTurn;
+	PlayerType winner = PlayerType::None;
+	bool gameOver = false;
+	bool reachedNewNode = false;
+	int emptyCount = 0;
 
-	if (currentGame->playerO == -1 || currentGame->playerX == -1)
+	for (int row = 0; row < 3; row++)
 	{
-		printf("ERROR: Playing game with only one player present. Did you forget to wait for the second player in JoinGame()?\n");
-		Pause();
-		exit(1);
+		for (int col = 0; col < 3; col++)
+		{
+			if (board[row][col] == PlayerType::None)
+			{
+				emptyCount++;
+			}
+		}
 	}
 
-	while (currentGame->currentGameState == GameState::StillPlaying)
+	// Walk down the tree until we fall off of it, expanding the node we stop at if
+	//  no other thread is already doing so.
+	MctsNode* node = search->root;
+	while (!gameOver && !reachedNewNode)
 	{
-		if (currentGame->currentTurn != currentPlayer->type)
+		MctsNode* children = node->children.load(std::memory_order_acquire);
+		if (children == nullptr)
 		{
-			printf("ERROR: Wrong player is playing. You broke it.\n");
-			Pause();
-			exit(1);
+			MctsExpansionState expected = MctsExpansionState::Leaf;
+			if (!node->expansionState.compare_exchange_strong(expected, MctsExpansionState::Expanding))
+			{
+				// Another thread is expanding this node, play out from here instead of waiting
+				break;
+			}
+
+			children = MctsArenaAllocate(search->arena, emptyCount);
+			if (children == nullptr)
+			{
+				// The arena is full so the tree can't grow any further
+				node->expansionState.store(MctsExpansionState::Leaf, std::memory_order_relaxed);
+				break;
+			}
+
+			int childIndex = 0;
+			for (int move = 0; move < 9; move++)
+			{
+				if (board[move / 3][move % 3] == PlayerType::None)
+				{
+					MctsInitNode(&children[childIndex++], node, move, turn);
+				}
+			}
+			node->childCount = emptyCount;
+			node->children.store(children, std::memory_order_release);
+			node->expansionState.store(MctsExpansionState::Expanded, std::memory_order_release);
+
+			node = &children[(*randEngine)() % emptyCount];
+			reachedNewNode = true;
+		}
+		else
+		{
+			node = MctsSelectChild(node, children, search->settings->explorationConstant);
 		}
 
-		currentGame->currentTurn = (currentPlayer->type == PlayerType::X) ? PlayerType::O : PlayerType::X;
+		node->virtualLoss.fetch_add(1, std::memory_order_relaxed);
 
-		// Make a move on the game board. The result of this function will determine the current state of the board.
-		currentGame->currentGameState = MakeAMove(currentPlayer, currentGame);
-		PrintGameBoard(currentGame);
+		int row = node->move / 3;
+		int col = node->move % 3;
+		board[row][col] = turn;
+		emptyCount--;
 
-		switch (currentGame->currentGameState)
+		if (IsWinningMove(row, col, board, turn))
 		{
-		case GameState::StillPlaying:
-			///////////////////////////////////////////////////////////////////////////////////
-			// TODO:: The game is not over yet. We need to notify the other player that it's
-			//   their turn and then we must wait until they tell us it's our turn.
-			///////////////////////////////////////////////////////////////////////////////////
-			
-			continue;
-		case GameState::Won:
-			///////////////////////////////////////////////////////////////////////////////////
-			// TODO:: We have won the game, we must wake up the other player so they can break
-			//   out of the PlayGame function.
-			///////////////////////////////////////////////////////////////////////////////////
-			return;
-		case GameState::Draw:
-			///////////////////////////////////////////////////////////////////////////////////
-			// TODO:: The game ended in a tie, we must wake up the other player so they can break
-			//   out of the PlayGame function
-			///////////////////////////////////////////////////////////////////////////////////
-			return;
+			winner = turn;
+			gameOver = true;
+		}
+		else if (emptyCount == 0)
+		{
+			gameOver = true;
 		}
+		turn = (turn == PlayerType::X) ? PlayerType::O : PlayerType::X;
 	}
 
-	// Only one player will execute this logic. The winning/Tied player will exit this function
-	//   upon finding out the game is over.
-	if (currentGame->currentGameState == GameState::Won)
+	// Finish the game with uniformly random moves
+	while (!gameOver)
 	{
-		printf("Game %d:Player %d - Lost\n", currentGame->gameNumber, currentPlayer->id);
+		int pick = (*randEngine)() % emptyCount;
+		for (int move = 0; move < 9; move++)
+		{
+			if (board[move / 3][move % 3] == PlayerType::None && pick-- == 0)
+			{
+				int row = move / 3;
+				int col = move % 3;
+				board[row][col] = turn;
+				emptyCount--;
+
+				if (IsWinningMove(row, col, board, turn))
+				{
+					winner = turn;
+					gameOver = true;
+				}
+				else if (emptyCount == 0)
+				{
+					gameOver = true;
+				}
+				break;
+			}
+		}
+		turn = (turn == PlayerType::X) ? PlayerType::O : PlayerType::X;
+	}
+
+	// Back the result up to the root and remove our virtual loss along the way
+	for (MctsNode* current = node; current != nullptr; current = current->parent)
+	{
+		int reward = (winner == PlayerType::None) ? 1 : ((winner == current->mover) ? 2 : 0);
+		current->rewardSum.fetch_add(reward, std::memory_order_relaxed);
+		current->visitCount.fetch_add(1, std::memory_order_relaxed);
+		if (current->parent != nullptr)
+		{
+			current->virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Runs playouts on the calling thread until the search's iteration or time budget
+//   is used up.
+//
+// Arguments:
+//   search - The search shared by all threads
+//   randEngine - Random number generator owned by the calling thread
+///////////////////////////////////////////////////////////////////////////////////
+void MctsSearchThreadEntrypoint(MctsSearch* search, std::mt19937* randEngine)
+{
+	const MctsSettings* settings = search->settings;
+	long long playouts = 0;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	for (;;)
+	{
+		if (settings->iterationBudget > 0 && search->playoutsClaimed.fetch_add(1, std::memory_order_relaxed) >= settings->iterationBudget)
+		{
+			break;
+		}
+		if (settings->timeBudgetMs > 0 && std::chrono::steady_clock::now() >= search->deadline)
+		{
+			break;
+		}
+
+		MctsRunPlayout(search, randEngine);
+		playouts++;
+	}
+
+	long long elapsedNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	search->playoutsCompleted.fetch_add(playouts, std::memory_order_relaxed);
+	search->threadNanoseconds.fetch_add(elapsedNanoseconds, std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Pins the calling thread to a set of CPUs
+//
+// Arguments:
+//   cpus - The CPUs the thread may run on
+//   cpuCount - Number of entries in cpus
+//
+// Return:
+//   True if the thread was pinned, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool PinCurrentThreadToCpus(const int* cpus, int cpuCount)
+{
+#if defined __linux__
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	for (int i = 0; i < cpuCount; i++)
+	{
+		CPU_SET(cpus[i], &cpuSet);
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Entry point for MCTS helper threads. Waits for searches to be handed out by
+//   MctsChooseMove and joins each of them until the pool shuts down.
+//
+// Arguments:
+//   pool - The pool this helper belongs to
+//   seed - Seed for this thread's random number generator
+///////////////////////////////////////////////////////////////////////////////////
+void MctsHelperThreadEntrypoint(MctsHelperPool* pool, unsigned int seed)
+{
+	// A helper inherits the single CPU its player is pinned to, so spread it over the
+	//   player's helper CPUs instead
+	if (pool->cpuCount > 0 && !PinCurrentThreadToCpus(pool->cpus, pool->cpuCount))
+	{
+		printf("Warning: MCTS helper thread failed to set its CPU affinity\n");
+	}
+
+	std::mt19937 randEngine(seed);
+	long long finishedGeneration = 0;
+	std::unique_lock<std::mutex> poolLock(pool->poolMutex);
+
+	for (;;)
+	{
+		pool->workCondition.wait(poolLock, [pool, finishedGeneration] {
+			return pool->shutdown || pool->searchGeneration != finishedGeneration;
+		});
+		if (pool->shutdown)
+		{
+			return;
+		}
+
+		finishedGeneration = pool->searchGeneration;
+		MctsSearch* search = pool->search;
+		poolLock.unlock();
+
+		MctsSearchThreadEntrypoint(search, &randEngine);
+
+		poolLock.lock();
+		if (--pool->activeCount == 0)
+		{
+			pool->doneCondition.notify_one();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Creates the helper threads of an MCTS player
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that owns the helpers
+//   helperCount - Number of helper threads to create
+//
+// Return:
+//   The new pool. Release it with MctsReleaseHelperPool.
+///////////////////////////////////////////////////////////////////////////////////
+MctsHelperPool* MctsCreateHelperPool(Player* currentPlayer, int helperCount)
+{
+	MctsHelperPool* pool = new MctsHelperPool;
+	pool->threadCount = helperCount;
+	pool->search = nullptr;
+	pool->searchGeneration = 0;
+	pool->activeCount = 0;
+	pool->shutdown = false;
+	pool->cpus = currentPlayer->helperCpus;
+	pool->cpuCount = currentPlayer->helperCpuCount;
+	pool->threads = new std::thread[helperCount];
+	for (int i = 0; i < helperCount; i++)
+	{
+		pool->threads[i] = std::thread(MctsHelperThreadEntrypoint, pool, (unsigned int)currentPlayer->myRand());
+	}
+
+	return pool;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Stops and joins all helper threads of a pool and releases it
+//
+// Arguments:
+//   pool - The pool to release or nullptr
+///////////////////////////////////////////////////////////////////////////////////
+void MctsReleaseHelperPool(MctsHelperPool* pool)
+{
+	if (pool == nullptr)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> poolLock(pool->poolMutex);
+		pool->shutdown = true;
+		pool->workCondition.notify_all();
+	}
+
+	for (int i = 0; i < pool->threadCount; i++)
+	{
+		pool->threads[i].join();
+	}
+	delete[] pool->threads;
+	delete pool;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Picks a move for 'currentPlayer' with a Monte Carlo Tree Search. The player's
+//   thread and its (threadCount - 1) parked helper threads all search one shared
+//   tree whose nodes come from the player's arena.
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that is picking a move
+//   currentGame - Pointer to the game being played
+//
+// Return:
+//   Board spot (row * 3 + col) to play or -1 if the search produced no moves
+///////////////////////////////////////////////////////////////////////////////////
+int MctsChooseMove(Player* currentPlayer, const Game* currentGame)
+{
+	const MctsSettings* settings = currentPlayer->mctsSettings;
+	MctsArena* arena = &currentPlayer->mctsArena;
+
+	if (arena->nodes == nullptr)
+	{
+		arena->nodes = new MctsNode[arena->capacity];
+	}
+	MctsArenaReset(arena);
+
+	MctsSearch search;
+	memcpy(search.rootBoard, currentGame->gameBoard, sizeof(search.rootBoard));
+	search.rootTurn = currentPlayer->type;
+	search.arena = arena;
+	search.settings = settings;
+	search.playoutsClaimed.store(0, std::memory_order_relaxed);
+	search.playoutsCompleted.store(0, std::memory_order_relaxed);
+	search.threadNanoseconds.store(0, std::memory_order_relaxed);
+	search.root = MctsArenaAllocate(arena, 1);
+	MctsInitNode(search.root, nullptr, -1, (currentPlayer->type == PlayerType::X) ? PlayerType::O : PlayerType::X);
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	search.deadline = startTime + std::chrono::milliseconds(settings->timeBudgetMs);
+
+	// Wake up the helpers. The player's own thread takes part in the search alongside them.
+	int helperCount = settings->threadCount - 1;
+	MctsHelperPool* pool = nullptr;
+	if (helperCount > 0)
+	{
+		if (currentPlayer->mctsHelpers == nullptr)
+		{
+			currentPlayer->mctsHelpers = MctsCreateHelperPool(currentPlayer, helperCount);
+		}
+		pool = currentPlayer->mctsHelpers;
+
+		std::lock_guard<std::mutex> poolLock(pool->poolMutex);
+		pool->search = &search;
+		pool->activeCount = helperCount;
+		pool->searchGeneration++;
+		pool->workCondition.notify_all();
+	}
+
+	std::mt19937 randEngine((unsigned int)currentPlayer->myRand());
+	MctsSearchThreadEntrypoint(&search, &randEngine);
+
+	// The search lives on our stack so wait for every helper to be done with it
+	if (pool != nullptr)
+	{
+		std::unique_lock<std::mutex> poolLock(pool->poolMutex);
+		pool->doneCondition.wait(poolLock, [pool] {
+			return pool->activeCount == 0;
+		});
+		pool->search = nullptr;
+	}
+
+	// Throughput only counts the time threads actually spent running playouts
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	currentPlayer->mctsPlayouts += search.playoutsCompleted.load(std::memory_order_relaxed);
+	currentPlayer->mctsSearchSeconds += elapsedSeconds;
+	currentPlayer->mctsThreadSeconds += search.threadNanoseconds.load(std::memory_order_relaxed) / 1000000000.0;
+
+	// Play the most visited move
+	MctsNode* children = search.root->children.load(std::memory_order_acquire);
+	if (children == nullptr)
+	{
+		return -1;
+	}
+
+	MctsNode* bestChild = &children[0];
+	for (int i = 1; i < search.root->childCount; i++)
+	{
+		if (children[i].visitCount.load(std::memory_order_relaxed) > bestChild->visitCount.load(std::memory_order_relaxed))
+		{
+			bestChild = &children[i];
+		}
+	}
+
+	return bestChild->move;
+}
+
+#if defined __linux__
+///////////////////////////////////////////////////////////////////////////////////
+// Reads the first line of a sysfs file
+//
+// Arguments:
+//   path - Path of the file to read
+//   buffer - Receives the line
+//   bufferSize - Size of buffer in bytes
+//
+// Return:
+//   True if the file could be read, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool ReadSysfsLine(const char* path, char* buffer, int bufferSize)
+{
+	FILE* file = fopen(path, "r");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	bool result = fgets(buffer, bufferSize, file) != nullptr;
+	fclose(file);
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Parses a sysfs CPU or node list such as "0-3,8-11"
+//
+// Arguments:
+//   text - The list to parse
+//   inList - Array of maxEntries flags. Entries named in the list are set to true.
+//   maxEntries - Number of entries in inList
+///////////////////////////////////////////////////////////////////////////////////
+void ParseCpuList(const char* text, bool* inList, int maxEntries)
+{
+	while (*text >= '0' && *text <= '9')
+	{
+		char* end;
+		int first = (int)strtol(text, &end, 10);
+		int last = first;
+		if (*end == '-')
+		{
+			last = (int)strtol(end + 1, &end, 10);
+		}
+
+		for (int i = first; i <= last && i < maxEntries; i++)
+		{
+			inList[i] = true;
+		}
+
+		text = (*end == ',') ? end + 1 : end;
+	}
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////
+// Reads the CPU topology from sysfs and orders every CPU this process may run on so
+//   that SMT siblings, then CPUs sharing an L3 cache, then CPUs on the same NUMA
+//   node are next to each other.
+//
+// Arguments:
+//   topology - Receives the topology. Release it with ReleaseCpuTopology.
+//
+// Return:
+//   True if the topology could be read, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool LoadCpuTopology(CpuTopology* topology)
+{
+	topology->cpuCount = 0;
+	topology->cpuOrder = nullptr;
+	topology->cpuNode = nullptr;
+	topology->cpuL3Domain = nullptr;
+
+#if defined __linux__
+	// Sort key for a single CPU. Cores and L3 domains are identified by the lowest CPU
+	//  ID that belongs to them.
+	struct CpuSortKey
+	{
+		int node;
+		int l3Domain;
+		int core;
+		int cpu;
+	};
+
+	cpu_set_t allowedCpus;
+	if (sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus) != 0)
+	{
+		return false;
+	}
+
+	char path[256];
+	char line[4096];
+	bool* inList = new bool[CPU_SETSIZE];
+	int* nodeOfCpu = new int[CPU_SETSIZE];
+	CpuSortKey* keys = new CpuSortKey[CPU_SETSIZE];
+	int cpuCount = 0;
+
+	// Machines without NUMA information in sysfs are treated as a single node
+	memset(nodeOfCpu, 0, sizeof(int) * CPU_SETSIZE);
+	if (ReadSysfsLine("/sys/devices/system/node/online", line, sizeof(line)))
+	{
+		bool* nodeOnline = new bool[CPU_SETSIZE];
+		memset(nodeOnline, 0, sizeof(bool) * CPU_SETSIZE);
+		ParseCpuList(line, nodeOnline, CPU_SETSIZE);
+
+		for (int node = 0; node < CPU_SETSIZE; node++)
+		{
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+			if (!nodeOnline[node] || !ReadSysfsLine(path, line, sizeof(line)))
+			{
+				continue;
+			}
+
+			memset(inList, 0, sizeof(bool) * CPU_SETSIZE);
+			ParseCpuList(line, inList, CPU_SETSIZE);
+			for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (inList[cpu])
+				{
+					nodeOfCpu[cpu] = node;
+				}
+			}
+		}
+		delete[] nodeOnline;
+	}
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (!CPU_ISSET(cpu, &allowedCpus))
+		{
+			continue;
+		}
+
+		CpuSortKey* key = &keys[cpuCount++];
+		key->node = nodeOfCpu[cpu];
+		key->cpu = cpu;
+
+		// The first SMT sibling identifies the physical core
+		key->core = cpu;
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+		if (ReadSysfsLine(path, line, sizeof(line)))
+		{
+			key->core = atoi(line);
+		}
+
+		// The first CPU sharing the L3 cache identifies the L3 domain. Without an L3 every
+		//  core is its own domain.
+		key->l3Domain = key->core;
+		for (int index = 0; ; index++)
+		{
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+			if (!ReadSysfsLine(path, line, sizeof(line)))
+			{
+				break;
+			}
+			if (atoi(line) != 3)
+			{
+				continue;
+			}
+
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+			if (ReadSysfsLine(path, line, sizeof(line)))
+			{
+				key->l3Domain = atoi(line);
+			}
+			break;
+		}
+	}
+
+	std::sort(keys, keys + cpuCount, [](const CpuSortKey& a, const CpuSortKey& b) {
+		if (a.node != b.node)
+			return a.node < b.node;
+		if (a.l3Domain != b.l3Domain)
+			return a.l3Domain < b.l3Domain;
+		if (a.core != b.core)
+			return a.core < b.core;
+		return a.cpu < b.cpu;
+	});
+
+	if (cpuCount > 0)
+	{
+		topology->cpuCount = cpuCount;
+		topology->cpuOrder = new int[cpuCount];
+		topology->cpuNode = new int[cpuCount];
+		topology->cpuL3Domain = new int[cpuCount];
+		for (int i = 0; i < cpuCount; i++)
+		{
+			topology->cpuOrder[i] = keys[i].cpu;
+			topology->cpuNode[i] = keys[i].node;
+			topology->cpuL3Domain[i] = keys[i].l3Domain;
+		}
+	}
+
+	delete[] keys;
+	delete[] nodeOfCpu;
+	delete[] inList;
+
+	return cpuCount > 0;
+#else
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Releases all resources held by a topology loaded with LoadCpuTopology
+//
+// Arguments:
+//   topology - The topology to release
+///////////////////////////////////////////////////////////////////////////////////
+void ReleaseCpuTopology(CpuTopology* topology)
+{
+	delete[] topology->cpuOrder;
+	delete[] topology->cpuNode;
+	delete[] topology->cpuL3Domain;
+	topology->cpuOrder = nullptr;
+	topology->cpuNode = nullptr;
+	topology->cpuL3Domain = nullptr;
+	topology->cpuCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Splits the CPUs of a topology into pairs for pairs of players. Both CPUs of a pair
+//   share an L3 cache; only when no L3 domain has two CPUs are pairs built inside
+//   NUMA nodes instead. A domain's leftover CPU is skipped so a pair never spans two
+//   domains. When no domain has two CPUs both players of a pair share one CPU.
+//
+// Arguments:
+//   topology - The topology to pair up
+//   pairCpus - Receives two indexes into the topology's arrays for each pair. Must
+//     have room for (cpuCount * 2) entries.
+//
+// Return:
+//   The number of pairs
+///////////////////////////////////////////////////////////////////////////////////
+int BuildCpuPairs(const CpuTopology* topology, int* pairCpus)
+{
+	// cpuOrder is sorted by NUMA node, then L3 domain, so each domain is one run of entries
+	const int* domains[2] = { topology->cpuL3Domain, topology->cpuNode };
+	for (int level = 0; level < 2; level++)
+	{
+		int pairCount = 0;
+		int domainStart = 0;
+		for (int i = 1; i <= topology->cpuCount; i++)
+		{
+			if (i < topology->cpuCount && domains[level][i] == domains[level][domainStart])
+			{
+				continue;
+			}
+
+			for (int cpu = domainStart; cpu + 1 < i; cpu += 2)
+			{
+				pairCpus[pairCount * 2] = cpu;
+				pairCpus[pairCount * 2 + 1] = cpu + 1;
+				pairCount++;
+			}
+			domainStart = i;
+		}
+
+		if (pairCount > 0)
+		{
+			return pairCount;
+		}
+	}
+
+	for (int cpu = 0; cpu < topology->cpuCount; cpu++)
+	{
+		pairCpus[cpu * 2] = cpu;
+		pairCpus[cpu * 2 + 1] = cpu;
+	}
+
+	return topology->cpuCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Puts a constructed game back into its initial state so it can be played again
+//
+// Arguments:
+//   game - The game to reset. Nobody may be playing it.
+//   gameNumber - ID the game is played under
+///////////////////////////////////////////////////////////////////////////////////
+void ResetGame(Game* game, int gameNumber)
+{
+	game->playerO = -1;
+	game->playerX = -1;
+	game->gameNumber = gameNumber;
+	game->currentTurn = PlayerType::X;
+	game->currentGameState = GameState::StillPlaying;
+	game->playerCount = 0;
+	game->gameUniqueLock = nullptr;
+	memset(game->gameBoard, 0, sizeof(game->gameBoard));
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Constructs and initializes a range of games in the game pool's storage. The
+//   calling thread is the first one to touch the games' memory, so on NUMA machines
+//   the memory is placed on that thread's node.
+//
+// Arguments:
+//   perGameData - Storage for all games
+//   firstGameIndex - Index of the first game to initialize
+//   endGameIndex - One past the index of the last game to initialize
+///////////////////////////////////////////////////////////////////////////////////
+void InitializeGames(Game* perGameData, int firstGameIndex, int endGameIndex)
+{
+	std::allocator<Game> gameAllocator;
+
+	for (int i = firstGameIndex; i < endGameIndex; i++)
+	{
+		std::allocator_traits<std::allocator<Game>>::construct(gameAllocator, &perGameData[i]);
+		ResetGame(&perGameData[i], i + 1);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Records how long it took for 'currentPlayer' to wake up after the other player
+//   handed the turn over.
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that just woke up
+//   currentGame - Pointer to the game being played
+///////////////////////////////////////////////////////////////////////////////////
+void RecordHandoff(Player* currentPlayer, const Game* currentGame)
+{
+	currentPlayer->handoffCount++;
+	currentPlayer->handoffSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - currentGame->handoffStartTime).count();
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Prepares a results sink for use
+//
+// Arguments:
+//   sink - The sink to open
+//   format - Format to write the results in
+//   path - File to write the results to or nullptr for the standard output
+//
+// Return:
+//   True if the sink is ready, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool OpenResultsSink(ResultsSink* sink, ResultsFormat format, const char* path)
+{
+	sink->format = format;
+	sink->output = stdout;
+	sink->chunkCapacity = 4096;
+	sink->pendingRecords = new GameRecord[sink->chunkCapacity];
+	sink->pendingCount = 0;
+	sink->writeFailed = false;
+	sink->gamesCompleted.store(0);
+	sink->xWins.store(0);
+	sink->oWins.store(0);
+	sink->draws.store(0);
+
+	if (path != nullptr)
+	{
+		sink->output = fopen(path, (format == ResultsFormat::Binary) ? "wb" : "w");
+		if (sink->output == nullptr)
+		{
+			fprintf(stderr, "Error: Unable to open %s for writing.\n", path);
+			delete[] sink->pendingRecords;
+			sink->pendingRecords = nullptr;
+			return false;
+		}
+	}
+
+	// Game lines are streamed as games finish, so they come before the player results
+	if (format == ResultsFormat::Csv)
+	{
+		sink->writeFailed = fputs("gameNumber,playerX,playerO,result,winner\n", sink->output) < 0;
+	}
+	else if (format == ResultsFormat::Text)
+	{
+		sink->writeFailed = fputs("********* Game Results **********\n", sink->output) < 0;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Formats a chunk of records in the sink's format and writes it with a single write
+//
+// Arguments:
+//   sink - The sink to write to
+//   records - The records to write
+//   recordCount - Number of entries in records
+//
+// Note:
+//   A binary chunk is one block: the 4 byte magic "TTTR", a uint32 version (1) and a
+//   uint32 record count, followed by the columns int32 gameNumber[count],
+//   int32 playerX[count], int32 playerO[count] and uint8 winner[count]
+//   (0 = draw, 1 = X, 2 = O), all in native byte order. A file is a series of blocks.
+///////////////////////////////////////////////////////////////////////////////////
+void FormatResultsChunk(ResultsSink* sink, const GameRecord* records, int recordCount)
+{
+	if (recordCount == 0 || sink->format == ResultsFormat::Summary)
+	{
+		return;
+	}
+
+	// Big enough for the longest text line of a single record
+	const int maxLineLength = 128;
+	size_t bufferSize = (sink->format == ResultsFormat::Binary) ? (12 + (size_t)recordCount * 13) : ((size_t)recordCount * maxLineLength);
+	char* buffer = new char[bufferSize];
+	size_t length = 0;
+
+	if (sink->format == ResultsFormat::Binary)
+	{
+		uint32_t header[3];
+		memcpy(&header[0], "TTTR", 4);
+		header[1] = 1;
+		header[2] = (uint32_t)recordCount;
+		memcpy(buffer, header, sizeof(header));
+		length = sizeof(header);
+
+		int32_t* gameNumbers = (int32_t*)(buffer + length);
+		int32_t* playersX = gameNumbers + recordCount;
+		int32_t* playersO = playersX + recordCount;
+		uint8_t* winners = (uint8_t*)(playersO + recordCount);
+		for (int i = 0; i < recordCount; i++)
+		{
+			gameNumbers[i] = records[i].gameNumber;
+			playersX[i] = records[i].playerX;
+			playersO[i] = records[i].playerO;
+			winners[i] = (uint8_t)records[i].winner;
+		}
+		length += (size_t)recordCount * 13;
+	}
+	else
+	{
+		for (int i = 0; i < recordCount; i++)
+		{
+			const GameRecord* record = &records[i];
+			if (sink->format == ResultsFormat::Csv)
+			{
+				length += snprintf(buffer + length, maxLineLength, "%d,%d,%d,%s,%s\n",
+					record->gameNumber,
+					record->playerX,
+					record->playerO,
+					(record->winner == PlayerType::None) ? "Draw" : "Won",
+					(record->winner == PlayerType::X) ? "X" : ((record->winner == PlayerType::O) ? "O" : "")
+				);
+			}
+			else
+			{
+				length += snprintf(buffer + length, maxLineLength, "Game %d - 'X' player %d, 'O' player %d, game result %s\n",
+					record->gameNumber,
+					record->playerX,
+					record->playerO,
+					(record->winner == PlayerType::None) ? "Draw" : "Won"
+				);
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> writeLock(sink->writeMutex);
+		if (fwrite(buffer, 1, length, sink->output) != length)
+		{
+			sink->writeFailed = true;
+		}
+	}
+
+	delete[] buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Hands the result of a completed game to the sink. Called by the player that
+//   finished the game while it still holds the game's mutex.
+//
+// Arguments:
+//   sink - The sink receiving the result
+//   currentGame - Pointer to the game that just completed
+//   winner - Player that won or 'None' if the game was a draw
+//
+// Return:
+//   The chunk this result filled up or nullptr. The caller writes it with
+//   FormatResultsChunk once it no longer holds the game's mutex and then deletes it.
+///////////////////////////////////////////////////////////////////////////////////
+GameRecord* SubmitGameResult(ResultsSink* sink, const Game* currentGame, PlayerType winner)
+{
+	sink->gamesCompleted.fetch_add(1, std::memory_order_relaxed);
+	if (winner == PlayerType::X)
+	{
+		sink->xWins.fetch_add(1, std::memory_order_relaxed);
+	}
+	else if (winner == PlayerType::O)
+	{
+		sink->oWins.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		sink->draws.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (sink->format == ResultsFormat::Summary)
+	{
+		return nullptr;
+	}
+
+	GameRecord* fullChunk = nullptr;
+	{
+		std::lock_guard<std::mutex> chunkLock(sink->chunkMutex);
+		GameRecord* record = &sink->pendingRecords[sink->pendingCount++];
+		record->gameNumber = currentGame->gameNumber;
+		record->playerX = currentGame->playerX;
+		record->playerO = currentGame->playerO;
+		record->winner = winner;
+
+		// Swap in an empty chunk so the other players can keep submitting while we format this one
+		if (sink->pendingCount == sink->chunkCapacity)
+		{
+			fullChunk = sink->pendingRecords;
+			sink->pendingRecords = new GameRecord[sink->chunkCapacity];
+			sink->pendingCount = 0;
+		}
+	}
+
+	return fullChunk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Writes any records still pending and releases all resources held by the sink.
+//   Must only be called once every player thread has finished.
+//
+// Arguments:
+//   sink - The sink to close
+///////////////////////////////////////////////////////////////////////////////////
+void CloseResultsSink(ResultsSink* sink)
+{
+	FormatResultsChunk(sink, sink->pendingRecords, sink->pendingCount);
+	delete[] sink->pendingRecords;
+	sink->pendingRecords = nullptr;
+	sink->pendingCount = 0;
+
+	// Buffered records only reach the output here, so this is where a full disk shows up
+	if (sink->output != stdout)
+	{
+		sink->writeFailed = (fclose(sink->output) != 0) || sink->writeFailed;
+	}
+	else
+	{
+		sink->writeFailed = (fflush(stdout) != 0) || sink->writeFailed;
+	}
+	sink->output = nullptr;
+
+	if (sink->writeFailed)
+	{
+		fprintf(stderr, "Error: Unable to write all game results, the results output is incomplete.\n");
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Packs a board into a single base 3 number (one digit per spot: 0 = None, 1 = X,
+//   2 = O) that uniquely identifies it.
+//
+// Arguments:
+//   board - The board to pack
+//
+// Return:
+//   The packed board in the range [0, 19683)
+///////////////////////////////////////////////////////////////////////////////////
+int PackBoard(const PlayerType board[3][3])
+{
+	int packedBoard = 0;
+	for (int spot = 8; spot >= 0; spot--)
+	{
+		packedBoard = (packedBoard * 3) + (int)board[spot / 3][spot % 3];
+	}
+
+	return packedBoard;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Determines if 'type' has completed a row, column or diagonal anywhere on 'board'
+//
+// Arguments:
+//   board - The board to check
+//   type - The player to check for
+//
+// Return:
+//   True if 'type' has won on 'board', otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool HasCompletedLine(const PlayerType board[3][3], PlayerType type)
+{
+	for (int spot = 0; spot < 9; spot++)
+	{
+		if (board[spot / 3][spot % 3] == type && IsWinningMove(spot / 3, spot % 3, board, type))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Parses a board written as 9 characters row by row, 'X', 'O' or '.' for an empty
+//   spot, and checks that it can come up in a game where X moves first.
+//
+// Arguments:
+//   text - The board to parse
+//   board - Receives the board
+//   turn - Receives the player to move
+//
+// Return:
+//   True if the board is valid, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool ParseBoard(const char* text, PlayerType board[3][3], PlayerType* turn)
+{
+	if (strlen(text) != 9)
+	{
+		return false;
+	}
+
+	int xCount = 0;
+	int oCount = 0;
+	for (int spot = 0; spot < 9; spot++)
+	{
+		switch (text[spot])
+		{
+		case 'X':
+		case 'x':
+			board[spot / 3][spot % 3] = PlayerType::X;
+			xCount++;
+			break;
+		case 'O':
+		case 'o':
+			board[spot / 3][spot % 3] = PlayerType::O;
+			oCount++;
+			break;
+		case '.':
+			board[spot / 3][spot % 3] = PlayerType::None;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	// X moves first, so X has either as many pieces as O or one more. The game stops at the
+	//   first win, so only the player that moved last can have won.
+	bool xWon = HasCompletedLine(board, PlayerType::X);
+	bool oWon = HasCompletedLine(board, PlayerType::O);
+	if ((xCount != oCount && xCount != oCount + 1) ||
+		(xWon && (oWon || xCount != oCount + 1)) ||
+		(oWon && xCount != oCount))
+	{
+		return false;
+	}
+
+	*turn = (xCount == oCount) ? PlayerType::X : PlayerType::O;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Computes the exact outcome probabilities of a game in which both players pick a
+//   uniformly random empty spot on every move, starting from 'board' with 'turn' to
+//   move. Results are memoized per packed board. Several threads may share one memo
+//   table: an entry is only written by the thread that claimed it, and any other
+//   thread reaching it before it's ready computes the value itself.
+//
+// Arguments:
+//   memo - Memo table with one entry per packed board
+//   board - The board to start from. It's restored before returning.
+//   turn - The player to move
+//
+// Return:
+//   Probabilities of X winning, O winning and a draw
+///////////////////////////////////////////////////////////////////////////////////
+OutcomeProbabilities ComputeRandomPlayOutcome(AnalyticMemoEntry* memo, PlayerType board[3][3], PlayerType turn)
+{
+	AnalyticMemoEntry* entry = &memo[PackBoard(board)];
+	if (entry->state.load(std::memory_order_acquire) == AnalyticMemoState::Ready)
+	{
+		return entry->outcome;
+	}
+
+	OutcomeProbabilities outcome = { 0.0, 0.0, 0.0 };
+	int possibleMoves[9];
+	int totalPossibleMoves = 0;
+
+	for (int spot = 0; spot < 9; spot++)
+	{
+		if (board[spot / 3][spot % 3] == PlayerType::None)
+		{
+			possibleMoves[totalPossibleMoves++] = spot;
+		}
+	}
+
+	if (totalPossibleMoves == 0)
+	{
+		// There are no more moves left, the game is a draw
+		outcome.draw = 1.0;
+	}
+
+	for (int i = 0; i < totalPossibleMoves; i++)
+	{
+		int row = possibleMoves[i] / 3;
+		int col = possibleMoves[i] % 3;
+		double moveProbability = 1.0 / totalPossibleMoves;
+
+		board[row][col] = turn;
+		if (IsWinningMove(row, col, board, turn))
+		{
+			if (turn == PlayerType::X)
+				outcome.xWin += moveProbability;
+			else
+				outcome.oWin += moveProbability;
+		}
+		else
+		{
+			OutcomeProbabilities next = ComputeRandomPlayOutcome(memo, board, (turn == PlayerType::X) ? PlayerType::O : PlayerType::X);
+			outcome.xWin += moveProbability * next.xWin;
+			outcome.oWin += moveProbability * next.oWin;
+			outcome.draw += moveProbability * next.draw;
+		}
+		board[row][col] = PlayerType::None;
+	}
+
+	AnalyticMemoState expected = AnalyticMemoState::Empty;
+	if (entry->state.compare_exchange_strong(expected, AnalyticMemoState::Computing))
+	{
+		entry->outcome = outcome;
+		entry->state.store(AnalyticMemoState::Ready, std::memory_order_release);
+	}
+
+	return outcome;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Entry point for the threads that compute the outcome of one opening move
+//
+// Arguments:
+//   memo - Memo table shared by all threads
+//   openingSpot - Spot (row * 3 + col) X opens the game with
+//   outcome - Receives the outcome probabilities after the opening move
+///////////////////////////////////////////////////////////////////////////////////
+void AnalyticThreadEntrypoint(AnalyticMemoEntry* memo, int openingSpot, OutcomeProbabilities* outcome)
+{
+	PlayerType board[3][3];
+	memset(board, 0, sizeof(board));
+	board[openingSpot / 3][openingSpot % 3] = PlayerType::X;
+
+	*outcome = ComputeRandomPlayOutcome(memo, board, PlayerType::O);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Computes and prints the exact outcome probabilities of random vs random play, both
+//   overall and for each opening move by X. Each opening move is computed on its
+//   own thread, all sharing one memo table. The memo table then answers a query for
+//   any other position.
+//
+// Arguments:
+//   overall - Receives the overall outcome probabilities
+//   queryBoard - Position to report the outcome of as well or nullptr for none
+//   queryTurn - Player to move in queryBoard
+///////////////////////////////////////////////////////////////////////////////////
+void RunAnalyticMode(OutcomeProbabilities* overall, const PlayerType queryBoard[3][3], PlayerType queryTurn)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	AnalyticMemoEntry* memo = new AnalyticMemoEntry[19683];
+	for (int i = 0; i < 19683; i++)
+	{
+		memo[i].state.store(AnalyticMemoState::Empty, std::memory_order_relaxed);
+	}
+
+	OutcomeProbabilities perOpening[9];
+	std::thread openingThreads[9];
+	for (int spot = 0; spot < 9; spot++)
+	{
+		openingThreads[spot] = std::thread(AnalyticThreadEntrypoint, memo, spot, &perOpening[spot]);
+	}
+
+	overall->xWin = 0.0;
+	overall->oWin = 0.0;
+	overall->draw = 0.0;
+	for (int spot = 0; spot < 9; spot++)
+	{
+		openingThreads[spot].join();
+		overall->xWin += perOpening[spot].xWin / 9.0;
+		overall->oWin += perOpening[spot].oWin / 9.0;
+		overall->draw += perOpening[spot].draw / 9.0;
+	}
+
+	int memoizedStates = 0;
+	for (int i = 0; i < 19683; i++)
+	{
+		if (memo[i].state.load(std::memory_order_relaxed) == AnalyticMemoState::Ready)
+		{
+			memoizedStates++;
+		}
+	}
+
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	// Every position reachable from the empty board is in the memo table by now. A game that's
+	//   already over has a certain outcome.
+	OutcomeProbabilities queryOutcome = { 0.0, 0.0, 0.0 };
+	bool queryGameOver = false;
+	if (queryBoard != nullptr)
+	{
+		PlayerType board[3][3];
+		memcpy(board, queryBoard, sizeof(board));
+		if (HasCompletedLine(board, PlayerType::X))
+		{
+			queryOutcome.xWin = 1.0;
+			queryGameOver = true;
+		}
+		else if (HasCompletedLine(board, PlayerType::O))
+		{
+			queryOutcome.oWin = 1.0;
+			queryGameOver = true;
+		}
+		else
+		{
+			queryOutcome = ComputeRandomPlayOutcome(memo, board, queryTurn);
+		}
+	}
+	delete[] memo;
+
+	printf("********* Analytic Results (random vs random) **********\n");
+	for (int spot = 0; spot < 9; spot++)
+	{
+		printf("X opens at [Row: %d, Col: %d], X Win %.6f, O Win %.6f, Draw %.6f\n",
+			spot / 3,
+			spot % 3,
+			perOpening[spot].xWin,
+			perOpening[spot].oWin,
+			perOpening[spot].draw
+		);
+	}
+	printf("Overall, X Win %.6f, O Win %.6f, Draw %.6f\n", overall->xWin, overall->oWin, overall->draw);
+	if (queryBoard != nullptr)
+	{
+		const char pieces[3] = { '.', 'X', 'O' };
+		char boardText[12];
+		for (int spot = 0, length = 0; spot < 9; spot++)
+		{
+			boardText[length++] = pieces[(int)queryBoard[spot / 3][spot % 3]];
+			if (spot == 2 || spot == 5)
+				boardText[length++] = '|';
+		}
+		boardText[11] = '\0';
+
+		printf("Position %s, %s, X Win %.6f, O Win %.6f, Draw %.6f\n",
+			boardText,
+			queryGameOver ? "game over" : ((queryTurn == PlayerType::X) ? "X to move" : "O to move"),
+			queryOutcome.xWin,
+			queryOutcome.oWin,
+			queryOutcome.draw
+		);
+	}
+	printf("Computed %d position(s) in %.3f ms\n\n\n", memoizedStates, elapsedMs);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Compares the exact outcome probabilities with the rates observed in this run
+//
+// Arguments:
+//   expected - Exact outcome probabilities from RunAnalyticMode
+//   resultsSink - The sink that received every game result
+///////////////////////////////////////////////////////////////////////////////////
+void PrintAnalyticComparison(const OutcomeProbabilities* expected, const ResultsSink* resultsSink)
+{
+	long long gameCount = resultsSink->gamesCompleted.load();
+	if (gameCount == 0)
+	{
+		return;
+	}
+
+	const char* names[3] = { "X Win", "O Win", "Draw" };
+	double probabilities[3] = { expected->xWin, expected->oWin, expected->draw };
+	long long observedCounts[3] = { resultsSink->xWins.load(), resultsSink->oWins.load(), resultsSink->draws.load() };
+
+	printf("********* Analytic vs Observed **********\n");
+	for (int i = 0; i < 3; i++)
+	{
+		double observed = (double)observedCounts[i] / gameCount;
+		double standardError = sqrt(probabilities[i] * (1.0 - probabilities[i]) / gameCount);
+		printf("%s, Exact %.6f, Observed %.6f, Difference %+.6f (%+.2f standard errors)\n",
+			names[i],
+			probabilities[i],
+			observed,
+			observed - probabilities[i],
+			(standardError > 0.0) ? (observed - probabilities[i]) / standardError : 0.0
+		);
+	}
+	printf("\n\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Packs a board into the same base 3 number as PackBoard for all 8 rotations and
+//   reflections of the board and returns the smallest one, so every symmetric
+//   position shares one value table entry.
+//
+// Arguments:
+//   board - The board to canonicalize
+//
+// Return:
+//   The canonical packed board in the range [0, 19683)
+///////////////////////////////////////////////////////////////////////////////////
+int CanonicalizeBoard(const PlayerType board[3][3])
+{
+	// Where each spot (row * 3 + col) ends up under each of the 8 symmetries of the board
+	static const int symmetrySpots[8][9] = {
+		{ 0, 1, 2, 3, 4, 5, 6, 7, 8 }, // Identity
+		{ 2, 5, 8, 1, 4, 7, 0, 3, 6 }, // Rotate 90
+		{ 8, 7, 6, 5, 4, 3, 2, 1, 0 }, // Rotate 180
+		{ 6, 3, 0, 7, 4, 1, 8, 5, 2 }, // Rotate 270
+		{ 2, 1, 0, 5, 4, 3, 8, 7, 6 }, // Mirror columns
+		{ 6, 7, 8, 3, 4, 5, 0, 1, 2 }, // Mirror rows
+		{ 0, 3, 6, 1, 4, 7, 2, 5, 8 }, // Transpose
+		{ 8, 5, 2, 7, 4, 1, 6, 3, 0 }  // Anti-transpose
+	};
+	static const int powersOfThree[9] = { 1, 3, 9, 27, 81, 243, 729, 2187, 6561 };
+
+	int canonicalBoard = INT_MAX;
+	for (int symmetry = 0; symmetry < 8; symmetry++)
+	{
+		int packedBoard = 0;
+		for (int spot = 0; spot < 9; spot++)
+		{
+			packedBoard += (int)board[spot / 3][spot % 3] * powersOfThree[symmetrySpots[symmetry][spot]];
+		}
+
+		if (packedBoard < canonicalBoard)
+		{
+			canonicalBoard = packedBoard;
+		}
+	}
+
+	return canonicalBoard;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Allocates a value table with every board valued as a draw
+//
+// Arguments:
+//   table - The table to initialize
+///////////////////////////////////////////////////////////////////////////////////
+void InitValueTable(ValueTable* table)
+{
+	table->entryCount = 19683;
+	table->values = new std::atomic<float>[table->entryCount];
+	for (int i = 0; i < table->entryCount; i++)
+	{
+		table->values[i].store(0.5f, std::memory_order_relaxed);
+	}
+	table->episodes.store(0);
+	table->snapshotsWritten.store(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Releases all resources held by a value table
+//
+// Arguments:
+//   table - The table to release
+///////////////////////////////////////////////////////////////////////////////////
+void ReleaseValueTable(ValueTable* table)
+{
+	delete[] table->values;
+	table->values = nullptr;
+	table->entryCount = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Writes a copy of the value table to disk. The copy is written to a temporary file
+//   which then replaces 'path', so readers never see a partial snapshot. Learning
+//   threads keep updating the table while it's being copied.
+//
+// Arguments:
+//   table - The table to save
+//   path - File to write the snapshot to
+//
+// Return:
+//   True if the snapshot was written, otherwise false
+//
+// Note:
+//   A snapshot is the 4 byte magic "TTTV", a uint32 version (1) and a uint32 entry
+//   count followed by one float per entry, all in native byte order.
+///////////////////////////////////////////////////////////////////////////////////
+bool SaveValueTableSnapshot(ValueTable* table, const char* path)
+{
+	std::lock_guard<std::mutex> snapshotLock(table->snapshotMutex);
+
+	size_t snapshotSize = 12 + sizeof(float) * table->entryCount;
+	char* snapshot = new char[snapshotSize];
+	uint32_t header[3];
+	memcpy(&header[0], "TTTV", 4);
+	header[1] = 1;
+	header[2] = (uint32_t)table->entryCount;
+	memcpy(snapshot, header, sizeof(header));
+
+	float* values = (float*)(snapshot + sizeof(header));
+	for (int i = 0; i < table->entryCount; i++)
+	{
+		values[i] = table->values[i].load(std::memory_order_relaxed);
+	}
+
+	char temporaryPath[1024];
+	snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+
+	bool result = false;
+	FILE* file = fopen(temporaryPath, "wb");
+	if (file != nullptr)
+	{
+		result = fwrite(snapshot, 1, snapshotSize, file) == snapshotSize;
+		result = (fclose(file) == 0) && result;
+	}
+	delete[] snapshot;
+
+	// Replace the previous snapshot in one step. rename only does that on POSIX systems.
+	if (result)
+	{
+#if defined _WIN32
+		result = MoveFileExA(temporaryPath, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		result = rename(temporaryPath, path) == 0;
+#endif
+	}
+
+	if (result)
+	{
+		table->snapshotsWritten.fetch_add(1);
+	}
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Loads a snapshot written by SaveValueTableSnapshot into an initialized table
+//
+// Arguments:
+//   table - The table to load into
+//   path - File to read the snapshot from
+//
+// Return:
+//   True if the snapshot was loaded, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool LoadValueTableSnapshot(ValueTable* table, const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	uint32_t header[3];
+	bool result = fread(header, sizeof(header), 1, file) == 1 &&
+		memcmp(&header[0], "TTTV", 4) == 0 &&
+		header[1] == 1 &&
+		header[2] == (uint32_t)table->entryCount;
+
+	if (result)
+	{
+		float* values = new float[table->entryCount];
+		result = fread(values, sizeof(float), table->entryCount, file) == (size_t)table->entryCount;
+		if (result)
+		{
+			for (int i = 0; i < table->entryCount; i++)
+			{
+				table->values[i].store(values[i], std::memory_order_relaxed);
+			}
+		}
+		delete[] values;
+	}
+	fclose(file);
+
+	return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Picks the move whose resulting board has the best value for 'currentPlayer' in
+//   the player's value table. Learning players explore by picking a random move
+//   instead with probability explorationRate and remember every board they move to
+//   so LearnFromGame can update them.
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that is picking a move
+//   currentGame - Pointer to the game being played
+//
+// Return:
+//   Board spot (row * 3 + col) to play or -1 if a random move should be played
+///////////////////////////////////////////////////////////////////////////////////
+int ValueTableChooseMove(Player* currentPlayer, const Game* currentGame)
+{
+	bool learning = currentPlayer->strategy == PlayerStrategy::Learning;
+	const LearningSettings* settings = currentPlayer->learningSettings;
+	PlayerType board[3][3];
+	memcpy(board, currentGame->gameBoard, sizeof(board));
+
+	int bestMove = -1;
+	int bestBoard = -1;
+	float bestValue = -1.0f;
+	int tieCount = 0;
+	bool explore = learning && currentPlayer->myRand() < settings->explorationRate * INT_MAX;
+
+	for (int spot = 0; spot < 9; spot++)
+	{
+		int row = spot / 3;
+		int col = spot % 3;
+		if (board[row][col] != PlayerType::None)
+		{
+			continue;
+		}
+
+		board[row][col] = currentPlayer->type;
+		int canonicalBoard = CanonicalizeBoard(board);
+		board[row][col] = PlayerType::None;
+
+		// Values are stored from X's point of view and exploring moves are all worth the same
+		float value = explore ? 0.0f : currentPlayer->valueTable->values[canonicalBoard].load(std::memory_order_relaxed);
+		if (currentPlayer->type == PlayerType::O && !explore)
+		{
+			value = 1.0f - value;
+		}
+
+		// Break ties uniformly at random
+		if (value > bestValue)
+		{
+			bestValue = value;
+			tieCount = 1;
+			bestMove = spot;
+			bestBoard = canonicalBoard;
+		}
+		else if (value == bestValue && currentPlayer->myRand() % ++tieCount == 0)
+		{
+			bestMove = spot;
+			bestBoard = canonicalBoard;
+		}
+	}
+
+	if (learning && bestMove != -1)
+	{
+		currentPlayer->learningHistory[currentPlayer->learningHistoryCount++] = bestBoard;
+	}
+
+	return bestMove;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Updates the shared value table with the boards 'currentPlayer' moved to during
+//   the game that just ended. Each board is moved towards the value of the board
+//   after it, ending with the game's result. Updates use relaxed atomic loads and
+//   stores without any locking (Hogwild), so concurrent updates to the same entry can
+//   occasionally overwrite each other.
+//
+// Arguments:
+//   currentPlayer - Pointer to the learning player
+//   winner - Player that won the game or 'None' if it was a draw
+//
+// Note:
+//   Called once the game's mutex has been released, so neither the table update nor
+//   a snapshot holds up the other player.
+///////////////////////////////////////////////////////////////////////////////////
+void LearnFromGame(Player* currentPlayer, PlayerType winner)
+{
+	ValueTable* table = currentPlayer->valueTable;
+	const LearningSettings* settings = currentPlayer->learningSettings;
+
+	float target = 0.5f;
+	if (winner != PlayerType::None)
+	{
+		target = (winner == PlayerType::X) ? 1.0f : 0.0f;
+	}
+
+	for (int i = currentPlayer->learningHistoryCount - 1; i >= 0; i--)
+	{
+		std::atomic<float>* entry = &table->values[currentPlayer->learningHistory[i]];
+		float value = entry->load(std::memory_order_relaxed);
+		value += settings->learningRate * (target - value);
+		entry->store(value, std::memory_order_relaxed);
+		target = value;
+	}
+	currentPlayer->learningHistoryCount = 0;
+
+	long long episode = table->episodes.fetch_add(1, std::memory_order_relaxed) + 1;
+	if (settings->snapshotInterval > 0 && settings->snapshotPath != nullptr && episode % settings->snapshotInterval == 0)
+	{
+		if (!SaveValueTableSnapshot(table, settings->snapshotPath))
+		{
+			printf("Warning: Unable to write snapshot %s\n", settings->snapshotPath);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Play the entire game of Tic-Tac-Toe as 'currentPlayer' in 'currentGame'
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that is trying to play each game
+//   currentGame - Pointer to the game that is being joined
+//
+// Note:
+//   6. Pick a spot on the board to play
+//   7. IF The game is over: wake up the other player so it can play and return.
+//   7. IF The game isn't over: wake up the other player and go to sleep. Next player starts at #6
+//
+//  gameUniqueLock is the primary synchronization object 
+///////////////////////////////////////////////////////////////////////////////////
+GameState MakeAMove(Player* currentPlayer, Game* currentGame)
+{
+	int possibleMoves[9];
+	int totalPossibleMoves = 0;
+
+	// Find all valid moves this player can make
+	for (int row = 0; row < 3; row++)
+	{
+		for (int col = 0; col < 3; col++)
+		{
+			if (currentGame->gameBoard[row][col] == PlayerType::None)
+			{
+				possibleMoves[totalPossibleMoves++] = (row * 3) + col;
+			}
+		}
+	}
+
+	if (totalPossibleMoves != 0)
+	{
+		// There are valid moves left on the board, let the player's strategy pick one
+		int move = -1;
+		switch (currentPlayer->strategy)
+		{
+		case PlayerStrategy::MonteCarloTreeSearch:
+			move = MctsChooseMove(currentPlayer, currentGame);
+			break;
+		case PlayerStrategy::Learning:
+		case PlayerStrategy::Greedy:
+			move = ValueTableChooseMove(currentPlayer, currentGame);
+			break;
+		case PlayerStrategy::Random:
+			break;
+		}
+
+		if (move == -1)
+		{
+			// Pick a random valid location
+			int randomMoveIndex = currentPlayer->myRand() % totalPossibleMoves;
+			move = possibleMoves[randomMoveIndex];
+		}
+
+		int row = move / 3;
+		int col = move % 3;
+		currentGame->gameBoard[row][col] = currentPlayer->type;
+
+		LogProgress("Game %d: Player %d: Picked [Row: %d, Col: %d]\n", currentGame->gameNumber, currentPlayer->id, row, col);
+
+		if (DidWeWin(row, col, currentGame, currentPlayer))
+		{
+			LogProgress("Game %d:Player %d - Won\n", currentGame->gameNumber, currentPlayer->id);
+			currentPlayer->winCount++;
+
+			return GameState::Won;
+		}
+		else
+		{
+			return GameState::StillPlaying;
+		}
+	}
+
+	// There are no more moves left, game resulted in a draw.
+	LogProgress("Game %d:Player %d - Draw\n", currentGame->gameNumber, currentPlayer->id);
+	currentPlayer->drawCount++;
+
+	return GameState::Draw;
+}
+
+bool yourTurn = false;
+bool myTurn = false;
+
+///////////////////////////////////////////////////////////////////////////////////
+// Play the entire game of Tic-Tac-Toe as 'currentPlayer' in 'currentGame'
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that is trying to play each game
+//   currentGame - Pointer to the game that is being joined
+//
+// Note:
+//   6. Pick a spot on the board to play
+//   7. IF The game is over: wake up the other player so it can play and return.
+//   7. IF The game isn't over: wake up the other player and go to sleep. Next player starts at #6
+//
+//  gameUniqueLock is the primary synchronization object 
+///////////////////////////////////////////////////////////////////////////////////
+void PlayGame(Player* currentPlayer, Game* currentGame)
+{
+	LogProgress("Game %d:Player %d vs Player %d (Player %d) starting\n", currentGame->gameNumber, currentGame->playerX, currentGame->playerO, currentPlayer->id);
+
+	if (currentGame->playerO == -1 || currentGame->playerX == -1)
+	{
+		printf("ERROR: Playing game with only one player present. Did you forget to wait for the second player in JoinGame()?\n");
+		Pause();
+		exit(1);
+	}
+
+	while (currentGame->currentGameState == GameState::StillPlaying)
+	{
+		if (currentGame->currentTurn != currentPlayer->type)
+		{
+			printf("ERROR: Wrong player is playing. You broke it.\n");
+			Pause();
+			exit(1);
+		}
+
+		currentGame->currentTurn = (currentPlayer->type == PlayerType::X) ? PlayerType::O : PlayerType::X;
+
+		// Make a move on the game board. The result of this function will determine the current state of the board.
+		currentGame->currentGameState = MakeAMove(currentPlayer, currentGame);
+		if (printProgress)
+		{
+			PrintGameBoard(currentGame);
+		}
+
+		switch (currentGame->currentGameState)
+		{
+		case GameState::StillPlaying:
+			// The game is not over yet. Notify the other player that it's their turn and wait
+			//   until they tell us it's our turn. Both players store their own lock in
+			//   gameUniqueLock, so hold on to ours while we're waiting.
+			{
+				std::unique_lock<std::mutex>* gameUniqueLock = currentGame->gameUniqueLock;
+				currentGame->handoffStartTime = std::chrono::steady_clock::now();
+				currentGame->gameCondition.notify_one();
+				currentGame->gameCondition.wait(*gameUniqueLock, [currentGame, currentPlayer] {
+					return currentGame->currentTurn == currentPlayer->type || currentGame->currentGameState != GameState::StillPlaying;
+				});
+				currentGame->gameUniqueLock = gameUniqueLock;
+				RecordHandoff(currentPlayer, currentGame);
+			}
+			continue;
+		case GameState::Won:
+			// We have won the game, report it and wake up the other player so they can break out of PlayGame.
+			currentPlayer->fullResultsChunk = SubmitGameResult(currentPlayer->gamePool->resultsSink, currentGame, currentPlayer->type);
+			currentGame->handoffStartTime = std::chrono::steady_clock::now();
+			currentGame->gameCondition.notify_one();
+			return;
+		case GameState::Draw:
+			// The game ended in a tie, report it and wake up the other player so they can break out of PlayGame.
+			currentPlayer->fullResultsChunk = SubmitGameResult(currentPlayer->gamePool->resultsSink, currentGame, PlayerType::None);
+			currentGame->handoffStartTime = std::chrono::steady_clock::now();
+			currentGame->gameCondition.notify_one();
+			return;
+		}
+	}
+
+	// Only one player will execute this logic. The winning/Tied player will exit this function
+	//   upon finding out the game is over.
+	if (currentGame->currentGameState == GameState::Won)
+	{
+		LogProgress("Game %d:Player %d - Lost\n", currentGame->gameNumber, currentPlayer->id);
 		(currentPlayer->loseCount)++;
 	}
 	else if (currentGame->currentGameState == GameState::Draw)
 	{
-		printf("Game %d:Player %d - Draw\n", currentGame->gameNumber, currentPlayer->id);
+		LogProgress("Game %d:Player %d - Draw\n", currentGame->gameNumber, currentPlayer->id);
 		(currentPlayer->drawCount)++; // count draw
 	}
 }
@@ -482,29 +2678,52 @@ void JoinGame(Player* currentPlayer, Game* currentGame)
 
 	if (currentGame->playerO == -1)
 	{
-		printf("Player %d joining game %d as 'O'\n", currentPlayer->id, currentGame->gameNumber);
+		LogProgress("Player %d joining game %d as 'O'\n", currentPlayer->id, currentGame->gameNumber);
 
 		currentGame->playerO = currentPlayer->id;
 		currentPlayer->type = PlayerType::O;
 
-		///////////////////////////////////////////////////////////////////////////////////
-		// TODO:: We're the only player in the game right now so we need to wait for the 
-		//   other player to join the game and play it's turn.
-		///////////////////////////////////////////////////////////////////////////////////
-		return;
+		// We're the only player in the game right now so we need to wait for the other
+		//   player to join the game and play it's turn.
+		currentGame->gameCondition.wait(gameUniqueLock, [currentGame] {
+			return currentGame->currentTurn == PlayerType::O || currentGame->currentGameState != GameState::StillPlaying;
+		});
+		currentGame->gameUniqueLock = &gameUniqueLock;
+		RecordHandoff(currentPlayer, currentGame);
 	}
 	else
 	{
-		printf("Player %d joining game %d as 'X'\n", currentPlayer->id, currentGame->gameNumber);
+		LogProgress("Player %d joining game %d as 'X'\n", currentPlayer->id, currentGame->gameNumber);
 
 		currentGame->playerX = currentPlayer->id;
 		currentPlayer->type = PlayerType::X;
 	}
 
 	PlayGame(currentPlayer, currentGame);
+
+	// The turn has already been handed to the loser when a game is won
+	PlayerType winner = PlayerType::None;
+	if (currentGame->currentGameState == GameState::Won)
+	{
+		winner = (currentGame->currentTurn == PlayerType::O) ? PlayerType::X : PlayerType::O;
+	}
 	currentGame->gameUniqueLock = nullptr;
 	currentPlayer->gamesPlayed++;
 	gameUniqueLock.unlock();
+
+	if (currentPlayer->strategy == PlayerStrategy::Learning)
+	{
+		LearnFromGame(currentPlayer, winner);
+	}
+
+	// Format and write a chunk we filled up without holding up the game
+	if (currentPlayer->fullResultsChunk != nullptr)
+	{
+		ResultsSink* sink = currentPlayer->gamePool->resultsSink;
+		FormatResultsChunk(sink, currentPlayer->fullResultsChunk, sink->chunkCapacity);
+		delete[] currentPlayer->fullResultsChunk;
+		currentPlayer->fullResultsChunk = nullptr;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -516,15 +2735,15 @@ void JoinGame(Player* currentPlayer, Game* currentGame)
 ///////////////////////////////////////////////////////////////////////////////////
 void TryToPlayEachGame(Player* currentPlayer)
 {
-	printf("Player %d starting to play games...\n", currentPlayer->id);
+	LogProgress("Player %d starting to play games...\n", currentPlayer->id);
 
 	Game* listOfGames = currentPlayer->gamePool->perGameData;
-	int totalGameCount = currentPlayer->gamePool->totalGameCount;
 
 	// All of our player threads will be going through the pool of games looking for the any
 	//   games that aren't full. The player will join and play any non-full games it finds while
-	//   iterating through the list of games.
-	for (int i = 0; i < totalGameCount; i++)
+	//   iterating through the list of games. When threads are pinned each pair of players only
+	//   goes through its own range of games.
+	for (int i = currentPlayer->firstGameIndex; i < currentPlayer->endGameIndex; i++)
 	{
 		// Check to see if we can join this game
 		listOfGames[i].playerCountMutex.lock();
@@ -544,6 +2763,134 @@ void TryToPlayEachGame(Player* currentPlayer)
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////////
+// Decides whether another game may be created in the ring. Must be called with
+//   ringMutex locked.
+//
+// Arguments:
+//   ring - The ring of game slots
+//
+// Return:
+//   True if the game limit and the duration haven't been reached yet, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool CanCreateStreamingGame(const GameRing* ring)
+{
+	if (ring->maxGameCount > 0 && ring->gamesCreated >= ring->maxGameCount)
+	{
+		return false;
+	}
+
+	if (ring->durationMs > 0 && std::chrono::steady_clock::now() >= ring->startTime + std::chrono::milliseconds(ring->durationMs))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Makes the specified player keep joining and playing games that are created on
+//   demand in the ring of game slots, until the ring stops creating games.
+//
+// Arguments:
+//   currentPlayer - Pointer to the player that is trying to play each game
+//
+// Note:
+//   At most one slot is open (has a single player waiting for an opponent) at any
+//   time. A player joins the open slot if there is one, otherwise it creates a new
+//   game in the next free slot and waits there. Players only stop once there's no
+//   open slot and no more games can be created, so nobody is ever left waiting for
+//   an opponent. The last player to leave a slot recycles it.
+///////////////////////////////////////////////////////////////////////////////////
+void TryToPlayStreamingGames(Player* currentPlayer)
+{
+	LogProgress("Player %d starting to play streaming games...\n", currentPlayer->id);
+
+	GameRing* ring = currentPlayer->gamePool->gameRing;
+
+	for (;;)
+	{
+		int slot = -1;
+		std::chrono::steady_clock::time_point rateLimitTime;
+		bool rateLimited = false;
+		{
+			std::unique_lock<std::mutex> ringLock(ring->ringMutex);
+
+			if (ring->openSlot != -1)
+			{
+				// Someone is waiting for an opponent, join their game
+				slot = ring->openSlot;
+				ring->openSlot = -1;
+			}
+			else
+			{
+				if (!CanCreateStreamingGame(ring))
+				{
+					break;
+				}
+
+				// Don't create games faster than the target rate
+				if (ring->gamesPerSecondTarget > 0.0)
+				{
+					rateLimitTime = ring->startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double>(ring->gamesCreated / ring->gamesPerSecondTarget));
+					rateLimited = std::chrono::steady_clock::now() < rateLimitTime;
+				}
+
+				if (!rateLimited)
+				{
+					for (int i = 0; i < ring->slotCount && slot == -1; i++)
+					{
+						int candidate = (ring->nextSlot + i) % ring->slotCount;
+						if (!ring->slotInUse[candidate])
+						{
+							slot = candidate;
+						}
+					}
+
+					if (slot == -1)
+					{
+						// Every slot still has a player in it, wait for one to be recycled and start over
+						ring->slotFreeCondition.wait(ringLock);
+						continue;
+					}
+
+					// Reset the slot for a brand new game and wait in it for an opponent.
+					//   Game numbers wrap around after INT_MAX games.
+					ring->gamesCreated++;
+					ring->nextSlot = (slot + 1) % ring->slotCount;
+					ring->slotInUse[slot] = true;
+					ring->openSlot = slot;
+					ResetGame(&ring->slots[slot], (int)((ring->gamesCreated - 1) % INT_MAX) + 1);
+				}
+			}
+
+			if (slot != -1)
+			{
+				ring->slots[slot].playerCount++;
+			}
+		}
+
+		if (rateLimited)
+		{
+			std::this_thread::sleep_until(rateLimitTime);
+			continue;
+		}
+
+		JoinGame(currentPlayer, &ring->slots[slot]);
+
+		// The last player to leave the game recycles its slot
+		{
+			std::lock_guard<std::mutex> ringLock(ring->ringMutex);
+			if (--ring->slots[slot].playerCount == 0)
+			{
+				ring->slotInUse[slot] = false;
+				ring->slotFreeCondition.notify_all();
+			}
+		}
+	}
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 // Entry point for player threads. 
 //
@@ -552,51 +2899,54 @@ void TryToPlayEachGame(Player* currentPlayer)
 ///////////////////////////////////////////////////////////////////////////////////
 void PlayerThreadEntrypoint(Player* currentPlayer)
 {
-	printf("Player %d waiting on starting gun\n", currentPlayer->id);
+	if (currentPlayer->pinnedCpu != -1)
+	{
+		if (PinCurrentThreadToCpus(&currentPlayer->pinnedCpu, 1))
+		{
+			printf("Player %d pinned to CPU %d on node %d\n", currentPlayer->id, currentPlayer->pinnedCpu, currentPlayer->pinnedNode);
+		}
+		else
+		{
+			printf("Player %d failed to pin to CPU %d\n", currentPlayer->id, currentPlayer->pinnedCpu);
+		}
+	}
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Let main know there's one more player thread running then wait for a
-	//   notification from main via the condition variable you created in the PlayerPool
-	//   struct.
-	//
-	// Notes:
-	//   * Please remember that to do a wait on a condition variable you will need a unique_lock
-	//     that was constructed using a mutex corresponding to the condition variable you're using.
-	//     For example, if you had a 'count', 'countMutex' and a 'countCondition' then there's a really
-	//     good chance that all three variables will be used to control access to the 'count'. If we
-	//     wanted to wait for a change on 'count', we would probably wait using 'countCondition' and a
-	//     unique_lock that was constructed using 'countMutex'.
-	//   * Please note that it's very easy to create a 'hole' in the synchronization and miss
-	//     the signal from main. If you find that a few of your threads are stuck on the wait in this
-	//     section of code then you probably have a hole in your synchronization here. If this happens
-	//     then you probably let main 'fire' the gun (via notify) before you were waiting on it.
-	//
-	///////////////////////////////////////////////////////////////////////////////////
-	currentPlayer->playerPool->countMutex.try_lock();
-	currentPlayer->playerPool->count++;
-	currentPlayer->playerPool->countMutex.unlock();
+	// Construct our games from this thread so their memory is local to the CPU we're pinned to
+	if (currentPlayer->initializesGames)
+	{
+		InitializeGames(currentPlayer->gamePool->perGameData, currentPlayer->firstGameIndex, currentPlayer->endGameIndex);
+	}
 
-	/*std::unique_lock<std::mutex> playerUniqueLock(currentPlayer->playerPool->countMutex);
-	currentPlayer->playerPool->playerUniqueLock = &playerUniqueLock;*/
-	while (!currentPlayer->playerPool->startGameFlag) {
+	LogProgress("Player %d waiting on starting gun\n", currentPlayer->id);
 
+	// Let main know there's one more player thread ready, then wait for the starting gun.
+	//   Both happen under countMutex so main can't fire the gun before we're waiting on it.
+	{
+		std::unique_lock<std::mutex> playerUniqueLock(currentPlayer->playerPool->countMutex);
+		currentPlayer->playerPool->count++;
+		currentPlayer->playerPool->countCondition.notify_all();
+		currentPlayer->playerPool->countCondition.wait(playerUniqueLock, [currentPlayer] {
+			return currentPlayer->playerPool->startGameFlag;
+		});
 	}
 
 	// Attempt to play each game, all of the game logic will occur in this function
-	printf("Player %d running\n", currentPlayer->id);
-	TryToPlayEachGame(currentPlayer);
-
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Let main know there's one less player thread running. You will be using the
-	//   playerPool to notify main of this change. The logic here will be similar, but
-	//   opposite, to what you did in the first TODO of this function.
-	///////////////////////////////////////////////////////////////////////////////////
-	currentPlayer->playerPool->countMutex.try_lock();
-	currentPlayer->playerPool->count--;
-	currentPlayer->playerPool->countMutex.unlock();
+	LogProgress("Player %d running\n", currentPlayer->id);
+	if (currentPlayer->gamePool->gameRing != nullptr)
+	{
+		TryToPlayStreamingGames(currentPlayer);
+	}
+	else
+	{
+		TryToPlayEachGame(currentPlayer);
+	}
 
-	/*currentPlayer->playerPool->playerUniqueLock = nullptr;
-	playerUniqueLock.unlock();*/
+	// Let main know there's one less player thread running
+	{
+		std::lock_guard<std::mutex> countLock(currentPlayer->playerPool->countMutex);
+		currentPlayer->playerPool->count--;
+		currentPlayer->playerPool->countCondition.notify_all();
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -605,21 +2955,21 @@ void PlayerThreadEntrypoint(Player* currentPlayer)
 // Arguments:
 //   perPlayerData - An array of player structs; one entry for each player.
 //   totalPlayerCount - Total number of players
-//   perGameData - An array of game data; one entry for each game.
-//   gameCount - Total number of games
+//   resultsSink - The sink that received every game result. The per game results
+//     have already been written by the sink under their own header, only its
+//     totals are printed here.
 ///////////////////////////////////////////////////////////////////////////////////
-void PrintResults(const Player* perPlayerData, int totalPlayerCount, const Game* perGameData, int totalGameCount)
+void PrintResults(const Player* perPlayerData, int totalPlayerCount, const ResultsSink* resultsSink)
 {
-	int totalGamesWon = 0;
-	int totalGamesTied = 0;
-	int totalPlayerWins = 0;
-	int totalPlayerLoses = 0;
-	int totalPlayerTies = 0;
+	// Streaming soak runs can play more games than fit in an int
+	long long totalPlayerWins = 0;
+	long long totalPlayerLoses = 0;
+	long long totalPlayerTies = 0;
 
 	printf("********* Player Results **********\n");
 	for (int i = 0; i < totalPlayerCount; i++)
 	{
-		printf("Player %d, Played %d game(s), Won %d, Lost %d, Draw %d\n",
+		printf("Player %d, Played %lld game(s), Won %lld, Lost %lld, Draw %lld\n",
 			perPlayerData[i].id,
 			perPlayerData[i].gamesPlayed,
 			perPlayerData[i].winCount,
@@ -632,28 +2982,436 @@ void PrintResults(const Player* perPlayerData, int totalPlayerCount, const Game*
 		totalPlayerTies += perPlayerData[i].drawCount;
 	}
 
-	printf("Total Players %d, Wins %d, Losses %d, Draws %d\n\n\n", totalPlayerCount, totalPlayerWins, totalPlayerLoses, (totalPlayerTies / 2));
+	printf("Total Players %d, Wins %lld, Losses %lld, Draws %lld\n\n\n", totalPlayerCount, totalPlayerWins, totalPlayerLoses, (totalPlayerTies / 2));
 
-	printf("********* Game Results **********\n");
-	for (int i = 0; i < totalGameCount; i++)
+	// Report how long it took to hand the turn from one player thread to the other
+	long long totalHandoffs = 0;
+	double totalHandoffSeconds = 0.0;
+	bool threadsPinned = false;
+	for (int i = 0; i < totalPlayerCount; i++)
+	{
+		totalHandoffs += perPlayerData[i].handoffCount;
+		totalHandoffSeconds += perPlayerData[i].handoffSeconds;
+		threadsPinned = threadsPinned || (perPlayerData[i].pinnedCpu != -1);
+	}
+	printf("Turn Handoffs %lld, Average Latency %.2f us, Player Threads %s\n\n\n",
+		totalHandoffs,
+		(totalHandoffs > 0) ? (totalHandoffSeconds * 1000000.0 / totalHandoffs) : 0.0,
+		threadsPinned ? "Pinned" : "Not Pinned"
+	);
+
+	// Report search throughput for every MCTS player
+	long long totalPlayouts = 0;
+	double totalThreadSeconds = 0.0;
+	for (int i = 0; i < totalPlayerCount; i++)
 	{
-		printf("Game %d - 'X' player %d, 'O' player %d, game result %s\n",
-			perGameData[i].gameNumber,
-			perGameData[i].playerX,
-			perGameData[i].playerO,
-			((perGameData[i].currentGameState == GameState::Won) ? "Won" : "Draw")
+		if (perPlayerData[i].strategy != PlayerStrategy::MonteCarloTreeSearch || perPlayerData[i].mctsThreadSeconds <= 0.0)
+		{
+			continue;
+		}
+
+		if (totalThreadSeconds == 0.0)
+		{
+			printf("********* MCTS Search Results **********\n");
+		}
+		printf("Player %d, %lld playout(s) in %.3f second(s) on %d thread(s), %.0f playouts/sec/thread\n",
+			perPlayerData[i].id,
+			perPlayerData[i].mctsPlayouts,
+			perPlayerData[i].mctsSearchSeconds,
+			perPlayerData[i].mctsSettings->threadCount,
+			perPlayerData[i].mctsPlayouts / perPlayerData[i].mctsThreadSeconds
 		);
 
-		if (perGameData[i].currentGameState == GameState::Won)
+		totalPlayouts += perPlayerData[i].mctsPlayouts;
+		totalThreadSeconds += perPlayerData[i].mctsThreadSeconds;
+	}
+
+	if (totalThreadSeconds > 0.0)
+	{
+		printf("Total Playouts %lld, %.0f playouts/sec/thread\n\n\n", totalPlayouts, totalPlayouts / totalThreadSeconds);
+	}
+
+	long long xWins = resultsSink->xWins.load();
+	long long oWins = resultsSink->oWins.load();
+
+	printf("********* Game Totals **********\n");
+	printf("'X' Won %lld, 'O' Won %lld\n", xWins, oWins);
+	printf("Total Games = %lld, %lld Games Won, %lld Games were a Draw\n", resultsSink->gamesCompleted.load(), xWins + oWins, resultsSink->draws.load());
+	if (resultsSink->writeFailed)
+	{
+		printf("Warning: Writing the game results failed, they are incomplete\n");
+	}
+	printf("\n\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Displays the training results of the learning players to the console
+//
+// Arguments:
+//   table - The value table shared by the learning players
+//   gameCount - Total number of games played
+//   runSeconds - Time from the starting gun until every player finished, in seconds
+///////////////////////////////////////////////////////////////////////////////////
+void PrintLearningResults(const ValueTable* table, long long gameCount, double runSeconds)
+{
+	printf("********* Learning Results **********\n");
+	printf("Learning Episodes %lld, Snapshots Written %d\n", table->episodes.load(), table->snapshotsWritten.load());
+	printf("Total Games %lld in %.3f second(s), %.0f games/sec\n\n\n",
+		gameCount,
+		runSeconds,
+		(runSeconds > 0.0) ? (gameCount / runSeconds) : 0.0
+	);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Displays the throughput of a streaming run to the console
+//
+// Arguments:
+//   ring - The ring the games were created in
+//   resultsSink - The sink that received every game result
+//   runSeconds - Time from the starting gun until every player finished, in seconds
+///////////////////////////////////////////////////////////////////////////////////
+void PrintStreamingResults(const GameRing* ring, const ResultsSink* resultsSink, double runSeconds)
+{
+	long long gameCount = resultsSink->gamesCompleted.load();
+
+	printf("********* Streaming Results **********\n");
+	printf("Streamed %lld game(s) through %d slot(s) in %.3f second(s), %.0f games/sec\n\n\n",
+		gameCount,
+		ring->slotCount,
+		runSeconds,
+		(runSeconds > 0.0) ? (gameCount / runSeconds) : 0.0
+	);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Prints the command line usage to the standard error
+///////////////////////////////////////////////////////////////////////////////////
+void PrintUsage()
+{
+	fprintf(stderr, "Usage: TicTacToe gameCount playerCount [options]\n\n");
+	fprintf(stderr, "Arguments:\n");
+	fprintf(stderr, "    gameCount                    Number of games. With --stream, 0 for no limit.\n");
+	fprintf(stderr, "    playerCount                  Number of players.                            \n\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "    --mcts-players count         Number of players that use MCTS (default 0).  \n");
+	fprintf(stderr, "    --mcts-threads count         Search threads per MCTS move (default: cores).\n");
+	fprintf(stderr, "    --mcts-iterations count      Playouts per MCTS move (default 1000).        \n");
+	fprintf(stderr, "    --mcts-time-ms milliseconds  Time per MCTS move instead of a playout count.\n");
+	fprintf(stderr, "    --mcts-arena-nodes count     Max tree nodes per MCTS search (default 262144).\n");
+	fprintf(stderr, "    --mcts-exploration value     UCT exploration constant (default 1.414).     \n");
+	fprintf(stderr, "    --pin                        Pin each pair of players to neighboring CPUs. \n");
+	fprintf(stderr, "    --output format              text, summary, csv or binary (default text).  \n");
+	fprintf(stderr, "    --output-file path           Write game results to a file instead of stdout.\n");
+	fprintf(stderr, "                                 Required for the csv and binary formats.      \n");
+	fprintf(stderr, "    --quiet                      Don't print per-move progress messages.       \n");
+	fprintf(stderr, "    --analytic                   Compute exact random vs random probabilities. \n");
+	fprintf(stderr, "    --analytic-board XO.......   Also compute them from this position (rows).  \n");
+	fprintf(stderr, "    --learning-players count     Players that learn a shared value table.      \n");
+	fprintf(stderr, "    --learning-rate value        Value table learning rate (default 0.1).      \n");
+	fprintf(stderr, "    --exploration-rate value     Chance of a random learning move (default 0.1).\n");
+	fprintf(stderr, "    --snapshot-file path         Write the value table here during and after the run.\n");
+	fprintf(stderr, "    --snapshot-interval count    Learning games between snapshots (default 0). \n");
+	fprintf(stderr, "    --greedy-players count       Players that play greedily from a snapshot.   \n");
+	fprintf(stderr, "    --load-snapshot path         Snapshot for greedy and learning players.     \n");
+	fprintf(stderr, "    --stream                     Create games on demand in a ring of slots.    \n");
+	fprintf(stderr, "    --ring-size count            Game slots when streaming (default: players). \n");
+	fprintf(stderr, "    --duration time              Stop streaming after e.g. 500ms, 30s, 10m, 1h.\n");
+	fprintf(stderr, "    --games-per-second-target n  Max streaming games created per second.       \n\n");
+	fprintf(stderr, "Game results are written as games finish, before the player results and the\n");
+	fprintf(stderr, "game totals that are printed once every game is over.\n");
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Parses a duration such as "500ms", "30s", "10m" or "1h". A number without a unit
+//   is in seconds.
+//
+// Arguments:
+//   text - The duration to parse
+//   milliseconds - Receives the duration in milliseconds
+//
+// Return:
+//   True if the duration was valid, otherwise false
+///////////////////////////////////////////////////////////////////////////////////
+bool ParseDuration(const char* text, long long* milliseconds)
+{
+	char* unit;
+	double amount = strtod(text, &unit);
+	if (unit == text || amount < 0.0)
+	{
+		return false;
+	}
+
+	double unitMilliseconds;
+	if (strcmp(unit, "ms") == 0)
+		unitMilliseconds = 1.0;
+	else if (strcmp(unit, "s") == 0 || *unit == '\0')
+		unitMilliseconds = 1000.0;
+	else if (strcmp(unit, "m") == 0)
+		unitMilliseconds = 60.0 * 1000.0;
+	else if (strcmp(unit, "h") == 0)
+		unitMilliseconds = 60.0 * 60.0 * 1000.0;
+	else
+		return false;
+
+	*milliseconds = (long long)(amount * unitMilliseconds);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+// Parses the optional arguments that follow gameCount and playerCount
+//
+// Arguments:
+//   argc - Number of command line arguments
+//   argv - The command line arguments
+//   options - Receives the parsed options
+//
+// Return:
+//   True if every option was valid, otherwise false after printing an error
+///////////////////////////////////////////////////////////////////////////////////
+bool ParseRunOptions(int argc, char** argv, RunOptions* options)
+{
+	unsigned int coreCount = std::thread::hardware_concurrency();
+	bool iterationsGiven = false;
+
+	options->mctsPlayerCount = 0;
+	options->mcts.threadCount = (coreCount > 0) ? (int)coreCount : 1;
+	options->mcts.iterationBudget = 1000;
+	options->mcts.timeBudgetMs = 0;
+	options->mcts.arenaNodeCapacity = 262144;
+	options->mcts.explorationConstant = 1.41421356;
+	options->pinThreads = false;
+	options->resultsFormat = ResultsFormat::Text;
+	options->resultsPath = nullptr;
+	options->printProgress = true;
+	options->analytic = false;
+	options->analyticQuery = false;
+	options->analyticTurn = PlayerType::X;
+	options->learningPlayerCount = 0;
+	options->greedyPlayerCount = 0;
+	options->learning.learningRate = 0.1f;
+	options->learning.explorationRate = 0.1f;
+	options->learning.snapshotInterval = 0;
+	options->learning.snapshotPath = nullptr;
+	options->loadSnapshotPath = nullptr;
+	options->streaming = false;
+	options->ringSize = 0;
+	options->durationMs = 0;
+	options->gamesPerSecondTarget = 0.0;
+
+	for (int i = 3; i < argc; i++)
+	{
+		const char* option = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+		// Options without a value
+		if (strcmp(option, "--pin") == 0)
+		{
+			options->pinThreads = true;
+			continue;
+		}
+		if (strcmp(option, "--quiet") == 0)
+		{
+			options->printProgress = false;
+			continue;
+		}
+		if (strcmp(option, "--analytic") == 0)
+		{
+			options->analytic = true;
+			continue;
+		}
+		if (strcmp(option, "--stream") == 0)
+		{
+			options->streaming = true;
+			continue;
+		}
+
+		if (value == nullptr)
+		{
+			fprintf(stderr, "Error: Missing value for option %s.\n", option);
+			return false;
+		}
+
+		if (strcmp(option, "--mcts-players") == 0)
+		{
+			options->mctsPlayerCount = atoi(value);
+		}
+		else if (strcmp(option, "--mcts-threads") == 0)
+		{
+			options->mcts.threadCount = atoi(value);
+		}
+		else if (strcmp(option, "--mcts-iterations") == 0)
+		{
+			options->mcts.iterationBudget = atoi(value);
+			iterationsGiven = true;
+		}
+		else if (strcmp(option, "--mcts-time-ms") == 0)
+		{
+			options->mcts.timeBudgetMs = atoi(value);
+		}
+		else if (strcmp(option, "--mcts-arena-nodes") == 0)
+		{
+			options->mcts.arenaNodeCapacity = atoi(value);
+		}
+		else if (strcmp(option, "--mcts-exploration") == 0)
+		{
+			options->mcts.explorationConstant = atof(value);
+		}
+		else if (strcmp(option, "--output") == 0)
+		{
+			if (strcmp(value, "text") == 0)
+				options->resultsFormat = ResultsFormat::Text;
+			else if (strcmp(value, "summary") == 0)
+				options->resultsFormat = ResultsFormat::Summary;
+			else if (strcmp(value, "csv") == 0)
+				options->resultsFormat = ResultsFormat::Csv;
+			else if (strcmp(value, "binary") == 0)
+				options->resultsFormat = ResultsFormat::Binary;
+			else
+			{
+				fprintf(stderr, "Error: Unknown output format %s.\n", value);
+				return false;
+			}
+		}
+		else if (strcmp(option, "--output-file") == 0)
+		{
+			options->resultsPath = value;
+		}
+		else if (strcmp(option, "--analytic-board") == 0)
+		{
+			if (!ParseBoard(value, options->analyticBoard, &options->analyticTurn))
+			{
+				fprintf(stderr, "Error: Invalid board %s. Use 9 of X, O or . row by row, as reached with X moving first.\n", value);
+				return false;
+			}
+			options->analytic = true;
+			options->analyticQuery = true;
+		}
+		else if (strcmp(option, "--learning-players") == 0)
+		{
+			options->learningPlayerCount = atoi(value);
+		}
+		else if (strcmp(option, "--learning-rate") == 0)
+		{
+			options->learning.learningRate = (float)atof(value);
+		}
+		else if (strcmp(option, "--exploration-rate") == 0)
 		{
-			totalGamesWon++;
+			options->learning.explorationRate = (float)atof(value);
+		}
+		else if (strcmp(option, "--snapshot-file") == 0)
+		{
+			options->learning.snapshotPath = value;
+		}
+		else if (strcmp(option, "--snapshot-interval") == 0)
+		{
+			options->learning.snapshotInterval = atoll(value);
+		}
+		else if (strcmp(option, "--greedy-players") == 0)
+		{
+			options->greedyPlayerCount = atoi(value);
+		}
+		else if (strcmp(option, "--load-snapshot") == 0)
+		{
+			options->loadSnapshotPath = value;
+		}
+		else if (strcmp(option, "--ring-size") == 0)
+		{
+			options->ringSize = atoi(value);
+		}
+		else if (strcmp(option, "--duration") == 0)
+		{
+			if (!ParseDuration(value, &options->durationMs))
+			{
+				fprintf(stderr, "Error: Invalid duration %s.\n", value);
+				return false;
+			}
+		}
+		else if (strcmp(option, "--games-per-second-target") == 0)
+		{
+			options->gamesPerSecondTarget = atof(value);
 		}
 		else
 		{
-			totalGamesTied++;
+			fprintf(stderr, "Error: Unknown option %s.\n", option);
+			return false;
 		}
+		i++;
+	}
+
+	// A time budget replaces the default playout budget unless both were asked for
+	if (options->mcts.timeBudgetMs > 0 && !iterationsGiven)
+	{
+		options->mcts.iterationBudget = 0;
+	}
+
+	if (options->mctsPlayerCount < 0 || options->mcts.iterationBudget < 0 || options->mcts.timeBudgetMs < 0 ||
+		options->learningPlayerCount < 0 || options->greedyPlayerCount < 0 || options->learning.snapshotInterval < 0 ||
+		options->ringSize < 0 || options->gamesPerSecondTarget < 0.0)
+	{
+		fprintf(stderr, "Error: All arguments must be positive integer values.\n");
+		return false;
+	}
+
+	if (options->mcts.iterationBudget == 0 && options->mcts.timeBudgetMs == 0)
+	{
+		fprintf(stderr, "Error: MCTS needs a playout or time budget.\n");
+		return false;
+	}
+
+	if (options->mcts.threadCount < 1)
+	{
+		fprintf(stderr, "Error: MCTS requires at least one search thread.\n");
+		return false;
+	}
+
+	if (!options->streaming && (options->ringSize > 0 || options->durationMs > 0 || options->gamesPerSecondTarget > 0.0))
+	{
+		fprintf(stderr, "Error: --ring-size, --duration and --games-per-second-target require --stream.\n");
+		return false;
 	}
-	printf("Total Games = %d, %d Games Won, %d Games were a Draw\n\n\n", totalGameCount, totalGamesWon, totalGamesTied);
+
+	if (options->learning.snapshotInterval > 0 && options->learning.snapshotPath == nullptr)
+	{
+		fprintf(stderr, "Error: --snapshot-interval requires --snapshot-file.\n");
+		return false;
+	}
+
+	if (options->learning.snapshotPath != nullptr && options->learningPlayerCount == 0)
+	{
+		fprintf(stderr, "Error: --snapshot-file requires --learning-players.\n");
+		return false;
+	}
+
+	if (options->greedyPlayerCount > 0 && options->loadSnapshotPath == nullptr)
+	{
+		fprintf(stderr, "Error: Greedy players require --load-snapshot.\n");
+		return false;
+	}
+
+	if (options->learning.learningRate < 0.0f || options->learning.learningRate > 1.0f ||
+		options->learning.explorationRate < 0.0f || options->learning.explorationRate > 1.0f)
+	{
+		fprintf(stderr, "Error: The learning and exploration rates must be between 0 and 1.\n");
+		return false;
+	}
+
+	// Player results and other messages always go to stdout, so a csv or binary stream
+	//   there couldn't be parsed
+	if ((options->resultsFormat == ResultsFormat::Binary || options->resultsFormat == ResultsFormat::Csv) && options->resultsPath == nullptr)
+	{
+		fprintf(stderr, "Error: The csv and binary output formats require --output-file.\n");
+		return false;
+	}
+
+	// The arena must at least be able to hold the root and all of its children
+	if (options->mcts.arenaNodeCapacity < 10)
+	{
+		fprintf(stderr, "Error: The MCTS arena requires at least 10 nodes.\n");
+		return false;
+	}
+
+	return true;
 }
 
 int main(int argc, char** argv)
@@ -672,18 +3430,30 @@ int main(int argc, char** argv)
 	Game* perGameData;
 	// Contains all of the games. See GamePool for more details.
 	GamePool poolOfGames;
-	if (argc != 3)
+	// Receives the result of every game. See ResultsSink for more details.
+	ResultsSink resultsSink;
+	// Ring of reusable game slots when streaming. See GameRing for more details.
+	GameRing gameRing;
+	// Number of entries in perGameData. Either the number of games or the number of ring slots.
+	int gameSlotCount;
+	// Optional settings from the command line. See RunOptions for more details.
+	RunOptions options;
+	if (argc < 3)
 	{
-		fprintf(stderr, "Usage: TicTacToe gameCount playerCount\n\n");
-		fprintf(stderr, "Arguments:\n");
-		fprintf(stderr, "    gameCount                    Number of games.                              \n");
-		fprintf(stderr, "    playerCount                  Number of players.                            \n");
+		PrintUsage();
 		Pause();
 		return 1;
 	}
 	totalGameCount = atoi(argv[1]);
 	totalPlayerCount = atoi(argv[2]);
 
+	if (!ParseRunOptions(argc, argv, &options))
+	{
+		PrintUsage();
+		Pause();
+		return 1;
+	}
+
 	if (totalGameCount < 0 || totalPlayerCount < 0)
 	{
 		fprintf(stderr, "Error: All arguments must be positive integer values.\n");
@@ -698,34 +3468,111 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	printf("%s starting %d player(s) for %d game(s)\n", argv[0], totalPlayerCount, totalGameCount);
+	printProgress = options.printProgress;
+
+	// The exact probabilities are computed up front so they can be compared with this run afterwards
+	OutcomeProbabilities analyticOutcome;
+	if (options.analytic)
+	{
+		RunAnalyticMode(&analyticOutcome, options.analyticQuery ? options.analyticBoard : nullptr, options.analyticTurn);
+		if (options.mctsPlayerCount > 0 || options.learningPlayerCount > 0 || options.greedyPlayerCount > 0)
+		{
+			printf("Warning: The analytic results assume every player picks random moves\n\n\n");
+		}
+	}
+
+	// Value table shared and trained by the learning players
+	ValueTable learningTable;
+	// Frozen value table the greedy players play from
+	ValueTable frozenTable;
+	InitValueTable(&learningTable);
+	InitValueTable(&frozenTable);
+	if (options.loadSnapshotPath != nullptr &&
+		(!LoadValueTableSnapshot(&learningTable, options.loadSnapshotPath) || !LoadValueTableSnapshot(&frozenTable, options.loadSnapshotPath)))
+	{
+		fprintf(stderr, "Error: Unable to load snapshot %s.\n", options.loadSnapshotPath);
+		ReleaseValueTable(&learningTable);
+		ReleaseValueTable(&frozenTable);
+		Pause();
+		return 1;
+	}
+
+	if (options.streaming)
+	{
+		// With one slot per player there's always a free slot for a new game
+		gameSlotCount = (options.ringSize > 0) ? options.ringSize : totalPlayerCount;
+		printf("%s streaming %d player(s) through %d game slot(s)\n", argv[0], totalPlayerCount, gameSlotCount);
+	}
+	else
+	{
+		gameSlotCount = totalGameCount;
+		printf("%s starting %d player(s) for %d game(s)\n", argv[0], totalPlayerCount, totalGameCount);
+	}
+
+	// Opened last so the text header sits right above the game lines
+	if (!OpenResultsSink(&resultsSink, options.resultsFormat, options.resultsPath))
+	{
+		ReleaseValueTable(&learningTable);
+		ReleaseValueTable(&frozenTable);
+		Pause();
+		return 1;
+	}
 
 	// Allocate and array of players
 	perPlayerData = new Player[totalPlayerCount];
 
-	// Allocate array of games
-	perGameData = new Game[totalGameCount];
+	// Allocate array of games. The games are constructed by InitializeGames so that, when threads
+	//   are pinned, each game is first touched by a thread running on the CPU that plays it.
+	perGameData = std::allocator<Game>().allocate(gameSlotCount);
 
 	// Initialize pool of games
 	poolOfGames.perGameData = perGameData;
-	poolOfGames.totalGameCount = totalGameCount;
+	poolOfGames.totalGameCount = gameSlotCount;
+	poolOfGames.resultsSink = &resultsSink;
+	poolOfGames.gameRing = nullptr;
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Initialize your data in the pool of players
-	///////////////////////////////////////////////////////////////////////////////////
+	if (options.streaming)
+	{
+		gameRing.slots = perGameData;
+		gameRing.slotCount = gameSlotCount;
+		gameRing.slotInUse = new bool[gameSlotCount];
+		memset(gameRing.slotInUse, 0, sizeof(bool) * gameSlotCount);
+		gameRing.nextSlot = 0;
+		gameRing.openSlot = -1;
+		gameRing.gamesCreated = 0;
+		gameRing.maxGameCount = totalGameCount;
+		gameRing.durationMs = options.durationMs;
+		gameRing.gamesPerSecondTarget = options.gamesPerSecondTarget;
+		poolOfGames.gameRing = &gameRing;
+	}
+
+	// Nobody is ready yet and the starting gun hasn't been fired
 	poolOfPlayers.count = 0;
 	poolOfPlayers.startGameFlag = false;
 
-	// Initialize each game
-	for (int i = 0; i < totalGameCount; i++)
+	// Read the CPU topology if player threads need to be pinned
+	CpuTopology topology;
+	bool pinThreads = options.pinThreads && LoadCpuTopology(&topology);
+	if (options.pinThreads && !pinThreads)
+	{
+		printf("Warning: Unable to read the CPU topology, player threads will not be pinned\n");
+	}
+
+	// Pairs of CPUs for the pairs of players
+	int* pairCpus = nullptr;
+	int cpuPairCount = 0;
+	if (pinThreads)
+	{
+		pairCpus = new int[topology.cpuCount * 2];
+		cpuPairCount = BuildCpuPairs(&topology, pairCpus);
+	}
+
+	// Initialize each game. When threads are pinned the players initialize their own games,
+	//   except for the ring slots, which are shared by every player.
+	bool playersInitializeGames = pinThreads && !options.streaming;
+	if (!playersInitializeGames)
 	{
-		perGameData[i].playerO = -1;
-		perGameData[i].playerX = -1;
-		perGameData[i].gameNumber = i + 1;
-		perGameData[i].currentTurn = PlayerType::X;
-		perGameData[i].currentGameState = GameState::StillPlaying;
-		perGameData[i].playerCount = 0;
-		memset(perGameData[i].gameBoard, 0, sizeof(perGameData[i].gameBoard));
+		InitializeGames(perGameData, 0, gameSlotCount);
 	}
 
 	// Initialize each player
@@ -740,41 +3587,165 @@ int main(int argc, char** argv)
 		perPlayerData[i].playerPool = &poolOfPlayers;
 		perPlayerData[i].type = PlayerType::None;
 		perPlayerData[i].myRand.Init(0, INT_MAX);
+		perPlayerData[i].strategy = PlayerStrategy::Random;
+		if (i < options.mctsPlayerCount)
+			perPlayerData[i].strategy = PlayerStrategy::MonteCarloTreeSearch;
+		else if (i < options.mctsPlayerCount + options.learningPlayerCount)
+			perPlayerData[i].strategy = PlayerStrategy::Learning;
+		else if (i < options.mctsPlayerCount + options.learningPlayerCount + options.greedyPlayerCount)
+			perPlayerData[i].strategy = PlayerStrategy::Greedy;
+		perPlayerData[i].mctsSettings = &options.mcts;
+		perPlayerData[i].mctsArena.nodes = nullptr;
+		perPlayerData[i].mctsArena.capacity = options.mcts.arenaNodeCapacity;
+		perPlayerData[i].mctsArena.used.store(0);
+		perPlayerData[i].mctsHelpers = nullptr;
+		perPlayerData[i].mctsPlayouts = 0;
+		perPlayerData[i].mctsSearchSeconds = 0.0;
+		perPlayerData[i].mctsThreadSeconds = 0.0;
+		perPlayerData[i].firstGameIndex = 0;
+		perPlayerData[i].endGameIndex = totalGameCount;
+		perPlayerData[i].initializesGames = false;
+		perPlayerData[i].pinnedCpu = -1;
+		perPlayerData[i].pinnedNode = -1;
+		perPlayerData[i].helperCpus = nullptr;
+		perPlayerData[i].helperCpuCount = 0;
+		perPlayerData[i].handoffCount = 0;
+		perPlayerData[i].handoffSeconds = 0.0;
+		perPlayerData[i].valueTable = (perPlayerData[i].strategy == PlayerStrategy::Greedy) ? &frozenTable : &learningTable;
+		perPlayerData[i].learningSettings = &options.learning;
+		perPlayerData[i].learningHistoryCount = 0;
+		perPlayerData[i].fullResultsChunk = nullptr;
+
+		if (pinThreads)
+		{
+			// Players 2k and 2k+1 are placed on a pair of CPUs from BuildCpuPairs and only play
+			//   each other's range of games. The first player of the pair constructs those games.
+			//   A leftover odd player joins the last pair, sharing the first player's CPU and the
+			//   pair's range of games. When streaming only the pinning applies.
+			int pairCount = totalPlayerCount / 2;
+			int pair = std::min(i / 2, pairCount - 1);
+			int member = i - (pair * 2);
+			int cpuIndex = pairCpus[((pair % cpuPairCount) * 2) + ((member == 1) ? 1 : 0)];
+			perPlayerData[i].pinnedCpu = topology.cpuOrder[cpuIndex];
+			perPlayerData[i].pinnedNode = topology.cpuNode[cpuIndex];
+
+			// MCTS helpers run on every CPU sharing the player's L3 cache. When that's too few
+			//   for the helpers they may use the player's whole NUMA node instead.
+			if (perPlayerData[i].strategy == PlayerStrategy::MonteCarloTreeSearch && options.mcts.threadCount > 1)
+			{
+				int l3CpuCount = 0;
+				for (int cpu = 0; cpu < topology.cpuCount; cpu++)
+				{
+					if (topology.cpuL3Domain[cpu] == topology.cpuL3Domain[cpuIndex])
+						l3CpuCount++;
+				}
+				bool useL3 = (l3CpuCount >= options.mcts.threadCount);
+
+				perPlayerData[i].helperCpus = new int[topology.cpuCount];
+				for (int cpu = 0; cpu < topology.cpuCount; cpu++)
+				{
+					bool sameDomain = useL3 ? (topology.cpuL3Domain[cpu] == topology.cpuL3Domain[cpuIndex]) : (topology.cpuNode[cpu] == topology.cpuNode[cpuIndex]);
+					if (sameDomain)
+						perPlayerData[i].helperCpus[perPlayerData[i].helperCpuCount++] = topology.cpuOrder[cpu];
+				}
+
+				if (perPlayerData[i].helperCpuCount < options.mcts.threadCount)
+				{
+					printf("Warning: Player %d has %d MCTS thread(s) but only %d CPU(s) on its node\n", i, options.mcts.threadCount, perPlayerData[i].helperCpuCount);
+				}
+			}
+
+			if (playersInitializeGames)
+			{
+				perPlayerData[i].firstGameIndex = (int)((long long)pair * totalGameCount / pairCount);
+				perPlayerData[i].endGameIndex = (int)((long long)(pair + 1) * totalGameCount / pairCount);
+				perPlayerData[i].initializesGames = (member == 0);
+			}
+		}
 	}
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Start the player threads. The player threads should begin executing in
-	//   the PlayerThreadEntrypoint function. Make sure to detach the threads.
-	///////////////////////////////////////////////////////////////////////////////////
+	if (pinThreads)
+	{
+		delete[] pairCpus;
+		ReleaseCpuTopology(&topology);
+	}
+
+	// Start the player threads. They're detached, main waits on the player count instead.
 	for (int i = 0; i < totalPlayerCount; i++) {
 		std::thread playerThread(PlayerThreadEntrypoint, &perPlayerData[i]);
 		playerThread.detach();
 	}
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Wait for all players to be ready 
-	///////////////////////////////////////////////////////////////////////////////////
-	while (poolOfPlayers.count != totalPlayerCount) {
+	// Wait for all players to be ready
+	std::unique_lock<std::mutex> mainUniqueLock(poolOfPlayers.countMutex);
+	poolOfPlayers.countCondition.wait(mainUniqueLock, [&poolOfPlayers, totalPlayerCount] {
+		return poolOfPlayers.count == totalPlayerCount;
+	});
 
-	}
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Notify all waiting threads that they can start playing.
-	///////////////////////////////////////////////////////////////////////////////////
+	// Fire the starting gun
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	gameRing.startTime = startTime;
 	poolOfPlayers.startGameFlag = true;
+	poolOfPlayers.countCondition.notify_all();
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Wait for all detached player threads to complete.
-	///////////////////////////////////////////////////////////////////////////////////
-	while (poolOfPlayers.count != 0) {
+	// Wait for all detached player threads to complete. Long streaming runs report their
+	//   progress every 10 seconds while we wait.
+	while (!poolOfPlayers.countCondition.wait_for(mainUniqueLock, std::chrono::seconds(10), [&poolOfPlayers] {
+		return poolOfPlayers.count == 0;
+	}))
+	{
+		if (options.streaming)
+		{
+			double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			long long gamesCompleted = resultsSink.gamesCompleted.load();
+			printf("Streaming: %lld game(s) completed in %.0f second(s), %.0f games/sec\n", gamesCompleted, elapsedSeconds, gamesCompleted / elapsedSeconds);
+		}
+	}
+	mainUniqueLock.unlock();
+	double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	CloseResultsSink(&resultsSink);
+	PrintResults(perPlayerData, totalPlayerCount, &resultsSink);
+	if (options.analytic)
+	{
+		PrintAnalyticComparison(&analyticOutcome, &resultsSink);
+	}
+	if (options.streaming)
+	{
+		PrintStreamingResults(&gameRing, &resultsSink, runSeconds);
+	}
+	if (options.learningPlayerCount > 0)
+	{
+		if (options.learning.snapshotPath != nullptr && !SaveValueTableSnapshot(&learningTable, options.learning.snapshotPath))
+		{
+			printf("Warning: Unable to write snapshot %s\n", options.learning.snapshotPath);
+		}
+		PrintLearningResults(&learningTable, resultsSink.gamesCompleted.load(), runSeconds);
+	}
 
+	// Release everything the players and games own
+	for (int i = 0; i < totalPlayerCount; i++)
+	{
+		MctsReleaseHelperPool(perPlayerData[i].mctsHelpers);
+		delete[] perPlayerData[i].helperCpus;
+		delete[] perPlayerData[i].mctsArena.nodes;
 	}
+	delete[] perPlayerData;
+	ReleaseValueTable(&learningTable);
+	ReleaseValueTable(&frozenTable);
 
-	PrintResults(perPlayerData, totalPlayerCount, perGameData, totalGameCount);
+	if (options.streaming)
+	{
+		delete[] gameRing.slotInUse;
+	}
 
-	///////////////////////////////////////////////////////////////////////////////////
-	// TODO:: Cleanup
-	///////////////////////////////////////////////////////////////////////////////////
+	std::allocator<Game> gameAllocator;
+	for (int i = 0; i < gameSlotCount; i++)
+	{
+		std::allocator_traits<std::allocator<Game>>::destroy(gameAllocator, &perGameData[i]);
+	}
+	gameAllocator.deallocate(perGameData, gameSlotCount);
 
 	Pause();
-	return 0;
+	return resultsSink.writeFailed ? 1 : 0;
 }